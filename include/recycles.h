@@ -3,9 +3,21 @@
 
 #include <iostream>
 #include <sstream>
+#include <format>
 #include <vector>
 #include <cstdint>
 #include <complex>
+#include <bit>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <span>
+#include <queue>
+#include <unordered_map>
+#include <thread>
 
 
 #ifdef _DEBUG
@@ -28,6 +40,8 @@ typedef int16_t  i16;
 typedef int32_t  i32;
 typedef int64_t  i64;
 typedef size_t   usize;
+__extension__ typedef __int128          i128;
+__extension__ typedef unsigned __int128 u128;
 
 typedef std::complex<i32> Pos;
 typedef std::complex<i32> Dir;
@@ -39,17 +53,87 @@ const Dir WEST (-1, 0);
 const Dir EAST ( 1, 0);
 
 
-template<typename T> 
+// Storage layouts for `Grid`. A layout maps a cell `(x, y)` to an offset in
+// the flat storage and reports how many elements that storage needs (which may
+// include padding cells that are never addressed).
+
+// Plain row-major storage, `y*cols + x`.
+struct RowMajor {
+    usize stride;
+
+    RowMajor(usize /*rows*/, usize cols) : stride(cols) {}
+
+    inline usize size(usize rows, usize cols) const { return rows * cols; }
+
+    inline usize index(usize x, usize y) const { return y*stride + x; }
+};
+
+
+// Square tiles of `N`x`N` cells stored contiguously, tiles in row-major order.
+// Neighbouring cells stay within the same cache lines for grids that no longer
+// fit in L1. `N` must be a power of two.
+template<usize N = 8>
+struct Tiled {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Tile size must be a power of two.");
+    static constexpr usize SHIFT = std::countr_zero(N);
+    static constexpr usize MASK = N - 1;
+
+    usize tiles_x;
+
+    Tiled(usize /*rows*/, usize cols) : tiles_x((cols + MASK) >> SHIFT) {}
+
+    inline usize size(usize rows, usize /*cols*/) const {
+        return ((rows + MASK) >> SHIFT) * tiles_x * N * N;
+    }
+
+    inline usize index(usize x, usize y) const {
+        const usize tile = (y >> SHIFT) * tiles_x + (x >> SHIFT);
+        return (tile << (2*SHIFT)) + ((y & MASK) << SHIFT) + (x & MASK);
+    }
+};
+
+
+// Z-order (Morton) storage. The grid is padded to a power-of-two square, so
+// very non-square grids waste memory.
+struct ZOrder {
+    ZOrder(usize /*rows*/, usize /*cols*/) {}
+
+    inline usize size(usize rows, usize cols) const {
+        const usize side = std::bit_ceil(std::max(rows, cols));
+        return side * side;
+    }
+
+    inline usize index(usize x, usize y) const {
+        return spread(x) | (spread(y) << 1);
+    }
+
+private:
+    // Spreads the lower 32 bits of `v` to the even bits of the result.
+    static inline u64 spread(u64 v) {
+        v &= 0x00000000FFFFFFFF;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFF;
+        v = (v | (v <<  8)) & 0x00FF00FF00FF00FF;
+        v = (v | (v <<  4)) & 0x0F0F0F0F0F0F0F0F;
+        v = (v | (v <<  2)) & 0x3333333333333333;
+        v = (v | (v <<  1)) & 0x5555555555555555;
+        return v;
+    }
+};
+
+
+template<typename T, typename Layout = RowMajor> 
 class Grid {
 public:
     usize rows;
     usize cols;
 
-    Grid(usize rows_, usize cols_, const T &value) : rows(rows_), cols(cols_), m_data(rows*cols, value) {}
+    Grid(usize rows_, usize cols_, const T &value)
+        : rows(rows_), cols(cols_), m_layout(rows, cols), m_data(m_layout.size(rows, cols), value) {}
 
-    Grid<T>& operator=(const Grid<T> &g) {
+    Grid<T, Layout>& operator=(const Grid<T, Layout> &g) {
         rows = g.rows;
         cols = g.cols;
+        m_layout = g.m_layout;
         m_data = g.m_data;
         return *this;
     }
@@ -70,7 +154,7 @@ public:
         } else if (y >= rows) {
             debug_println("y {} exceeds total number of rows({})!", y, rows-1);
         }
-        return m_data[y*cols + x];
+        return m_data[m_layout.index(x, y)];
     }
 
     const T& at(usize x, usize y) const {
@@ -79,7 +163,7 @@ public:
         } else if (y >= rows) {
             debug_println("y {} exceeds total number of rows({})!", y, rows-1);
         }
-        return m_data[y*cols + x];
+        return m_data[m_layout.index(x, y)];
     }
 
     T& operator()(usize x, usize y) { return at(x, y); }
@@ -90,7 +174,7 @@ public:
 
     const T& operator()(Pos pos) const { return at(pos.real(), pos.imag()); }
 
-    bool operator==(const Grid<T> &rhs) const {
+    bool operator==(const Grid<T, Layout> &rhs) const {
         if (rhs.cols != cols || rhs.rows != rows)
             return false;
 
@@ -122,15 +206,749 @@ public:
         return ss.str();
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Grid<T>& grid) {
+    friend std::ostream& operator<<(std::ostream& os, const Grid<T, Layout>& grid) {
         os << grid.toString();
         return os;
     }
 
 private:
+    Layout m_layout;
     std::vector<T> m_data;
 };
 
+// Half-open interval `[lo, hi)`. Interval arithmetic spans the whole domain
+// of `T` (identity pieces of a `PiecewiseMap`), so `T` has to be unsigned.
+template<typename T>
+struct Interval {
+    static_assert(std::is_unsigned_v<T>, "Interval bounds must be unsigned.");
+
+    T lo;
+    T hi;
+
+    inline bool empty() const { return hi <= lo; }
+
+    inline T size() const { return empty() ? T(0) : hi - lo; }
+
+    inline bool contains(T v) const { return lo <= v && v < hi; }
+
+    inline bool operator==(const Interval<T> &rhs) const = default;
+};
+
+
+// Sorted set of disjoint, non-adjacent half-open intervals. Adjacent or
+// overlapping intervals are coalesced on insertion.
+template<typename T>
+class IntervalSet {
+public:
+    IntervalSet() = default;
+
+    IntervalSet(T lo, T hi) {
+        if (lo < hi) m_data.push_back({lo, hi});
+    }
+
+    // Sorts and coalesces arbitrary intervals. O(n log n).
+    IntervalSet(std::vector<Interval<T>> intervals) {
+        std::sort(intervals.begin(), intervals.end(),
+            [](const Interval<T> &a, const Interval<T> &b) { return a.lo < b.lo; });
+        for (const auto &iv : intervals)
+            pushBack(iv);
+    }
+
+    bool empty() const { return m_data.empty(); }
+
+    // Number of values in the set.
+    T size() const {
+        T total = 0;
+        for (const auto &iv : m_data) total += iv.size();
+        return total;
+    }
+
+    T min() const { return m_data.front().lo; }
+
+    T max() const { return m_data.back().hi - 1; }
+
+    const std::vector<Interval<T>>& intervals() const { return m_data; }
+
+    typename std::vector<Interval<T>>::const_iterator begin() const { return m_data.begin(); }
+
+    typename std::vector<Interval<T>>::const_iterator end() const { return m_data.end(); }
+
+    bool contains(T v) const {
+        auto it = std::upper_bound(m_data.begin(), m_data.end(), v,
+            [](T val, const Interval<T> &iv) { return val < iv.lo; });
+        return it != m_data.begin() && std::prev(it)->contains(v);
+    }
+
+    void insert(T lo, T hi) {
+        *this = unite(IntervalSet(lo, hi));
+    }
+
+    // O(n + m) merge.
+    IntervalSet unite(const IntervalSet &rhs) const {
+        IntervalSet ret;
+        ret.m_data.reserve(m_data.size() + rhs.m_data.size());
+        auto a = m_data.begin(), b = rhs.m_data.begin();
+        while (a != m_data.end() || b != rhs.m_data.end()) {
+            if (b == rhs.m_data.end() || (a != m_data.end() && a->lo < b->lo))
+                ret.pushBack(*a++);
+            else
+                ret.pushBack(*b++);
+        }
+        return ret;
+    }
+
+    // O(n + m) merge.
+    IntervalSet intersect(const IntervalSet &rhs) const {
+        IntervalSet ret;
+        auto a = m_data.begin(), b = rhs.m_data.begin();
+        while (a != m_data.end() && b != rhs.m_data.end()) {
+            const Interval<T> iv{std::max(a->lo, b->lo), std::min(a->hi, b->hi)};
+            if (!iv.empty()) ret.m_data.push_back(iv);
+            if (a->hi < b->hi) ++a;
+            else ++b;
+        }
+        return ret;
+    }
+
+    // Splits the set into the values `< at` and the values `>= at`.
+    std::pair<IntervalSet, IntervalSet> split(T at) const {
+        std::pair<IntervalSet, IntervalSet> ret;
+        for (const auto &iv : m_data) {
+            if (iv.hi <= at)
+                ret.first.m_data.push_back(iv);
+            else if (iv.lo >= at)
+                ret.second.m_data.push_back(iv);
+            else {
+                ret.first.m_data.push_back({iv.lo, at});
+                ret.second.m_data.push_back({at, iv.hi});
+            }
+        }
+        return ret;
+    }
+
+    bool operator==(const IntervalSet &rhs) const = default;
+
+    std::string toString() const {
+        std::stringstream ss;
+        ss << '{';
+        for (usize i = 0; i < m_data.size(); ++i) {
+            ss << '[' << m_data[i].lo << ',' << m_data[i].hi << ')' << (i == m_data.size()-1 ? "" : ", ");
+        }
+        ss << '}';
+        return ss.str();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const IntervalSet& set) {
+        os << set.toString();
+        return os;
+    }
+
+private:
+    std::vector<Interval<T>> m_data;
+
+    // Appends an interval that starts at or after the last one, coalescing.
+    void pushBack(const Interval<T> &iv) {
+        if (iv.empty()) return;
+        if (!m_data.empty() && iv.lo <= m_data.back().hi)
+            m_data.back().hi = std::max(m_data.back().hi, iv.hi);
+        else
+            m_data.push_back(iv);
+    }
+};
+
+
+// Piece of a `PiecewiseMap`: maps `[lo, hi)` to `[dst, dst + hi - lo)`.
+template<typename T>
+struct Piece {
+    static_assert(std::is_unsigned_v<T>, "Piece bounds must be unsigned.");
+
+    T lo;
+    T hi;
+    T dst;
+
+    inline T operator()(T v) const { return dst + (v - lo); }
+};
+
+
+// Piecewise-linear map with unit slope. Values outside of every piece map to
+// themselves. Pieces are sorted and disjoint.
+template<typename T>
+class PiecewiseMap {
+public:
+    PiecewiseMap() = default;
+
+    // Pieces must not overlap. O(n log n).
+    PiecewiseMap(std::vector<Piece<T>> pieces) : m_data(std::move(pieces)) {
+        std::sort(m_data.begin(), m_data.end(),
+            [](const Piece<T> &a, const Piece<T> &b) { return a.lo < b.lo; });
+    }
+
+    const std::vector<Piece<T>>& pieces() const { return m_data; }
+
+    // O(log n)
+    T operator()(T v) const {
+        auto it = std::upper_bound(m_data.begin(), m_data.end(), v,
+            [](T val, const Piece<T> &p) { return val < p.lo; });
+        if (it != m_data.begin() && v < std::prev(it)->hi)
+            return (*std::prev(it))(v);
+        return v;
+    }
+
+    // Image of `set` under the map. Splitting is a linear sweep, sorting and
+    // coalescing the pieces of the image is O(k log k).
+    IntervalSet<T> image(const IntervalSet<T> &set) const {
+        std::vector<Interval<T>> ret;
+        forEachSegment(set, [&](const Interval<T> &iv, const Piece<T> &p) {
+            ret.push_back({p(iv.lo), p(iv.lo) + iv.size()});
+        });
+        return IntervalSet<T>(std::move(ret));
+    }
+
+    // Values mapped into `set`, gaps mapping to themselves included.
+    // O((n + k) log m) for k output intervals.
+    IntervalSet<T> preimage(const IntervalSet<T> &set) const {
+        std::vector<Interval<T>> ret;
+        const IntervalSet<T> domain(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max());
+        const auto &targets = set.intervals();
+        forEachSegment(domain, [&](const Interval<T> &iv, const Piece<T> &p) {
+            const T lo = p(iv.lo);
+            const T hi = lo + iv.size();
+            auto it = std::upper_bound(targets.begin(), targets.end(), lo,
+                [](T val, const Interval<T> &t) { return val < t.lo; });
+            if (it != targets.begin() && lo < std::prev(it)->hi) --it;
+            for (; it != targets.end() && it->lo < hi; ++it) {
+                const T a = std::max(lo, it->lo);
+                const T b = std::min(hi, it->hi);
+                if (a < b) ret.push_back({iv.lo + (a - lo), iv.lo + (b - lo)});
+            }
+        });
+        return IntervalSet<T>(std::move(ret));
+    }
+
+    // Map equivalent to applying `*this` and then `next`. O((n + m) log m).
+    PiecewiseMap compose(const PiecewiseMap &next) const {
+        PiecewiseMap ret;
+        const IntervalSet<T> domain(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max());
+        forEachSegment(domain, [&](const Interval<T> &iv, const Piece<T> &p) {
+            const IntervalSet<T> img(p(iv.lo), p(iv.lo) + iv.size());
+            next.forEachSegment(img, [&](const Interval<T> &niv, const Piece<T> &np) {
+                const T lo = iv.lo + (niv.lo - p(iv.lo));
+                ret.pushBack({lo, lo + niv.size(), np(niv.lo)});
+            });
+        });
+        return ret;
+    }
+
+private:
+    std::vector<Piece<T>> m_data;
+
+    // Calls `fn(sub_interval, piece)` for every part of `set` covered by a single
+    // piece, gaps included as identity pieces, in increasing order. Both sides
+    // are sorted, so this is a merge, galloping over runs of pieces between
+    // intervals: O(n log(m / n) + output) for n intervals and m pieces.
+    template<typename Fn>
+    void forEachSegment(const IntervalSet<T> &set, Fn fn) const {
+        auto it = m_data.begin();
+        const auto ends_before = [](const Piece<T> &p, T val) { return p.hi <= val; };
+        for (const Interval<T> &iv : set) {
+            T v = iv.lo;
+            usize step = 1;
+            while (step <= usize(m_data.end() - it) && ends_before(it[step - 1], v)) step *= 2;
+            it = std::lower_bound(it + step / 2, it + std::min(step, usize(m_data.end() - it)), v, ends_before);
+
+            while (v < iv.hi) {
+                if (it != m_data.end() && it->lo <= v) {
+                    const T hi = std::min(iv.hi, it->hi);
+                    fn(Interval<T>{v, hi}, *it);
+                    v = hi;
+                    if (it->hi <= v) ++it;
+                } else {
+                    const T hi = it != m_data.end() ? std::min(iv.hi, it->lo) : iv.hi;
+                    fn(Interval<T>{v, hi}, Piece<T>{v, hi, v});
+                    v = hi;
+                }
+            }
+        }
+    }
+
+    // Appends a piece after the last one, dropping identities and merging
+    // pieces that continue each other.
+    void pushBack(const Piece<T> &p) {
+        if (p.hi <= p.lo || p.dst == p.lo) return;
+        if (!m_data.empty()) {
+            Piece<T> &last = m_data.back();
+            if (last.hi == p.lo && last(last.hi - 1) + 1 == p.dst) {
+                last.hi = p.hi;
+                return;
+            }
+        }
+        m_data.push_back(p);
+    }
+};
+
+// splitmix64 finalizer
+inline u64 mix64(u64 x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline u64 hashCombine(u64 seed, u64 v) {
+    return mix64(seed ^ (mix64(v) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// 64-bit fingerprint of a byte buffer
+inline u64 fingerprint(const void *data, usize size, u64 seed = 0) {
+    const u8 *bytes = static_cast<const u8*>(data);
+    u64 h = hashCombine(seed, size);
+    usize i = 0;
+    for (; i + 8 <= size; i += 8) {
+        u64 word;
+        std::memcpy(&word, bytes + i, 8);
+        h = hashCombine(h, word);
+    }
+    if (i < size) {
+        u64 word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        h = hashCombine(h, word);
+    }
+    return h;
+}
+
+inline u64 fingerprint(const std::string &s, u64 seed = 0) {
+    return fingerprint(s.data(), s.size(), seed);
+}
+
+template<typename T>
+u64 fingerprint(const std::vector<T> &v, u64 seed = 0) {
+    static_assert(std::is_trivially_copyable_v<T>, "Fingerprinted elements must be trivially copyable.");
+    return fingerprint(v.data(), v.size() * sizeof(T), seed);
+}
+
+
+// Number of threads to split `n` items over: one per hardware thread, but
+// at least `min_chunk` items each, and at least one thread
+inline usize workerCount(usize n, usize min_chunk) {
+    return std::max<usize>(1, std::min<usize>(std::thread::hardware_concurrency(), n / min_chunk));
+}
+
+// Runs `fn(worker, first, last)` on `workers` threads, each getting an even
+// share of `[0, n)`. A single worker runs on the calling thread.
+template<typename Fn>
+void forEachChunk(usize n, usize workers, Fn fn) {
+    if (workers == 1) {
+        fn(usize(0), usize(0), n);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (usize w = 0; w < workers; ++w) {
+        threads.emplace_back(fn, w, n * w / workers, n * (w + 1) / workers);
+    }
+    for (auto &t : threads) t.join();
+}
+
+
+// Result of `CycleDetector::run`. Step `n` is the state after `n` calls to
+// the step function, step 0 being the initial state.
+struct Cycle {
+    u64 prefix = 0;         // first step that is part of the cycle
+    u64 period = 0;
+    std::vector<u64> hits;  // steps in `[0, prefix + period)` whose state is a hit
+
+    // Step in `[0, prefix + period)` with the same state as step `n`
+    u64 reduce(u64 n) const {
+        return n < prefix ? n : prefix + (n - prefix) % period;
+    }
+
+    bool isHit(u64 n) const {
+        return std::binary_search(hits.begin(), hits.end(), reduce(n));
+    }
+};
+
+
+// Finds the cycle of the sequence `s, step(s), step(step(s)), ...` where `s`
+// is returned by `init()`. States are compared through their 64-bit
+// fingerprints. The period is found with Brent's algorithm, then the
+// sequence is restarted and the last `period` fingerprints are kept in a
+// ring to find the prefix, so memory is O(period) and only one state is alive
+// at a time.
+//
+//   init():                  -> State
+//   step(State &)            advances the state in place
+//   fingerprint(const State&) -> u64
+//   is_hit(const State&)     -> bool, steps for which it holds are recorded
+template<typename Init, typename Step, typename Fingerprint, typename IsHit>
+class CycleDetector {
+public:
+    CycleDetector(Init init, Step step, Fingerprint fingerprint, IsHit is_hit)
+        : m_init(init), m_step(step), m_fingerprint(fingerprint), m_is_hit(is_hit) {}
+
+    Cycle run() {
+        Cycle cycle;
+        cycle.period = findPeriod();
+
+        std::vector<u64> ring(cycle.period);
+        auto state = m_init();
+        for (u64 n = 0;; ++n) {
+            const u64 fp = m_fingerprint(state);
+            u64 &slot = ring[n % cycle.period];
+            if (n >= cycle.period && slot == fp) {
+                cycle.prefix = n - cycle.period;
+                return cycle;
+            }
+            slot = fp;
+            if (m_is_hit(state))
+                cycle.hits.push_back(n);
+            m_step(state);
+        }
+    }
+
+private:
+    Init m_init;
+    Step m_step;
+    Fingerprint m_fingerprint;
+    IsHit m_is_hit;
+
+    u64 findPeriod() {
+        auto state = m_init();
+        u64 power = 1;
+        u64 period = 1;
+        u64 tortoise = m_fingerprint(state);
+        m_step(state);
+        u64 hare = m_fingerprint(state);
+        while (tortoise != hare) {
+            if (power == period) {
+                tortoise = hare;
+                power *= 2;
+                period = 0;
+            }
+            m_step(state);
+            hare = m_fingerprint(state);
+            ++period;
+        }
+        return period;
+    }
+};
+
+
+// Inverse of `a` modulo `m`, `a` and `m` must be coprime
+inline i128 modInverse(i128 a, i128 m) {
+    if (m == 1) return 0;
+    i128 old_r = a, r = m;
+    i128 old_s = 1, s = 0;
+    while (r != 0) {
+        const i128 q = old_r / r;
+        old_r -= q * r;
+        std::swap(old_r, r);
+        old_s -= q * s;
+        std::swap(old_s, s);
+    }
+    return (old_s % m + m) % m;
+}
+
+
+// First step that is a hit of every cycle, if any. Hits inside the longest
+// prefix are checked directly, later ones are combined with the generalised
+// Chinese remainder theorem.
+inline std::optional<u64> firstCommonHit(const std::vector<Cycle> &cycles) {
+    if (cycles.empty())
+        return std::nullopt;
+
+    auto longest = std::max_element(cycles.begin(), cycles.end(),
+        [](const Cycle &a, const Cycle &b) { return a.prefix < b.prefix; });
+    const u64 start = longest->prefix;
+    for (u64 hit : longest->hits) {
+        if (hit >= start) break;
+        if (std::all_of(cycles.begin(), cycles.end(), [&](const Cycle &c) { return c.isHit(hit); }))
+            return hit;
+    }
+
+    // Residues `r (mod m)` of the steps `>= start` that are hits of all cycles so far
+    std::vector<u64> residues{0};
+    u64 modulus = 1;
+    for (const Cycle &c : cycles) {
+        const u64 g = std::gcd(modulus, c.period);
+        const u64 lcm = modulus / g * c.period;
+        std::vector<u64> next;
+        for (u64 hit : c.hits) {
+            if (hit < c.prefix) continue;
+            const u64 b = hit % c.period;
+            for (u64 a : residues) {
+                // x = a + modulus*k = b (mod period)
+                const u64 diff = (b + c.period - a % c.period) % c.period;
+                if (diff % g != 0) continue;
+                const u64 m = c.period / g;
+                const i128 inv = modInverse((modulus / g) % m, m);
+                const u64 k = (u64)((i128)(diff / g) % m * inv % m);
+                next.push_back((u64)(((u128)a + (u128)modulus * k) % lcm));
+            }
+        }
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        if (next.empty())
+            return std::nullopt;
+        residues = std::move(next);
+        modulus = lcm;
+    }
+
+    u64 best = UINT64_MAX;
+    for (u64 r : residues) {
+        const u64 n = r >= start ? r : r + (start - r + modulus - 1) / modulus * modulus;
+        best = std::min(best, n);
+    }
+    return best;
+}
+
+
+// Assigns dense ids `0, 1, 2, ...` to keys in order of first appearance.
+template<typename Key, typename Hash = std::hash<Key>>
+class IdMap {
+public:
+    // Id of `key`, inserting it if it's new
+    u32 operator()(const Key &key) {
+        auto [it, inserted] = m_ids.try_emplace(key, (u32)m_keys.size());
+        if (inserted) m_keys.push_back(key);
+        return it->second;
+    }
+
+    std::optional<u32> find(const Key &key) const {
+        auto it = m_ids.find(key);
+        if (it == m_ids.end()) return std::nullopt;
+        return it->second;
+    }
+
+    const Key& key(u32 id) const { return m_keys[id]; }
+
+    usize size() const { return m_keys.size(); }
+
+private:
+    std::unordered_map<Key, u32, Hash> m_ids;
+    std::vector<Key> m_keys;
+};
+
+
+// Directed graph in compressed sparse row form. Nodes are dense ids
+// `[0, size())`, the outgoing edges of node `u` are the edge ids
+// `[edgeBegin(u), edgeEnd(u))` and keep the order they were given in.
+// Undirected graphs are stored as two directed edges.
+template<typename W = i32>
+class CsrGraph {
+public:
+    static constexpr u32 NO_EDGE = UINT32_MAX;
+
+    struct Edge {
+        u32 to;
+        W weight;
+    };
+
+    struct EdgeTriple {
+        u32 from;
+        u32 to;
+        W weight;
+    };
+
+    // Shortest path tree returned by the search kernels. `parent[v]` is the
+    // edge id used to reach `v`, `NO_EDGE` for the source and unreached nodes.
+    template<typename D>
+    struct SearchTree {
+        std::vector<D> dist;
+        std::vector<u32> parent;
+
+        static constexpr D UNREACHED = std::numeric_limits<D>::max();
+
+        bool reached(u32 v) const { return dist[v] != UNREACHED; }
+    };
+
+    CsrGraph() : m_offsets{0} {}
+
+    // Counting sort of the edges by source node. O(n + e).
+    CsrGraph(usize nodes, const std::vector<EdgeTriple> &edges)
+        : m_offsets(nodes + 1, 0), m_edges(edges.size()) {
+        for (const auto &e : edges)
+            ++m_offsets[e.from + 1];
+        std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+
+        std::vector<u32> next(m_offsets.begin(), m_offsets.end() - 1);
+        for (const auto &e : edges)
+            m_edges[next[e.from]++] = Edge{e.to, e.weight};
+    }
+
+    usize size() const { return m_offsets.size() - 1; }
+
+    usize edgeCount() const { return m_edges.size(); }
+
+    u32 edgeBegin(u32 u) const { return m_offsets[u]; }
+
+    u32 edgeEnd(u32 u) const { return m_offsets[u + 1]; }
+
+    u32 degree(u32 u) const { return edgeEnd(u) - edgeBegin(u); }
+
+    const Edge& edge(u32 e) const { return m_edges[e]; }
+
+    std::span<const Edge> neighbors(u32 u) const {
+        return {m_edges.data() + edgeBegin(u), degree(u)};
+    }
+
+    // Same nodes with every edge reversed
+    CsrGraph reversed() const {
+        std::vector<EdgeTriple> edges;
+        edges.reserve(edgeCount());
+        for (u32 u = 0; u < size(); ++u) {
+            for (const Edge &e : neighbors(u))
+                edges.push_back({e.to, u, e.weight});
+        }
+        return CsrGraph(size(), edges);
+    }
+
+    // Hop distances from `source`, following only edges for which
+    // `use_edge(edge_id)` holds.
+    template<typename EdgeFilter>
+    SearchTree<i32> bfs(u32 source, EdgeFilter use_edge) const {
+        SearchTree<i32> tree{std::vector<i32>(size(), SearchTree<i32>::UNREACHED),
+                             std::vector<u32>(size(), NO_EDGE)};
+        std::vector<u32> queue;
+        queue.reserve(size());
+        queue.push_back(source);
+        tree.dist[source] = 0;
+        for (usize head = 0; head < queue.size(); ++head) {
+            const u32 u = queue[head];
+            for (u32 e = edgeBegin(u); e < edgeEnd(u); ++e) {
+                const u32 v = m_edges[e].to;
+                if (tree.reached(v) || !use_edge(e)) continue;
+                tree.dist[v] = tree.dist[u] + 1;
+                tree.parent[v] = e;
+                queue.push_back(v);
+            }
+        }
+        return tree;
+    }
+
+    SearchTree<i32> bfs(u32 source) const {
+        return bfs(source, [](u32) { return true; });
+    }
+
+    // Weighted distances from `source`. Weights must be non-negative.
+    SearchTree<W> dijkstra(u32 source) const {
+        SearchTree<W> tree{std::vector<W>(size(), SearchTree<W>::UNREACHED),
+                           std::vector<u32>(size(), NO_EDGE)};
+        using Item = std::pair<W, u32>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+        tree.dist[source] = 0;
+        pq.emplace(0, source);
+        while (!pq.empty()) {
+            const auto [d, u] = pq.top();
+            pq.pop();
+            if (d != tree.dist[u]) continue;
+            for (u32 e = edgeBegin(u); e < edgeEnd(u); ++e) {
+                const Edge &edge = m_edges[e];
+                const W nd = d + edge.weight;
+                if (nd < tree.dist[edge.to]) {
+                    tree.dist[edge.to] = nd;
+                    tree.parent[edge.to] = e;
+                    pq.emplace(nd, edge.to);
+                }
+            }
+        }
+        return tree;
+    }
+
+    // Iterative depth-first search from `source`, calling `visit(node)` in
+    // preorder. Returns which nodes were visited.
+    template<typename Visit>
+    std::vector<bool> dfs(u32 source, Visit visit) const {
+        std::vector<bool> seen(size(), false);
+        std::vector<u32> stack{source};
+        while (!stack.empty()) {
+            const u32 u = stack.back();
+            stack.pop_back();
+            if (seen[u]) continue;
+            seen[u] = true;
+            visit(u);
+            // Pushed in reverse so neighbours are visited in edge order
+            for (u32 e = edgeEnd(u); e-- > edgeBegin(u);) {
+                if (!seen[m_edges[e].to])
+                    stack.push_back(m_edges[e].to);
+            }
+        }
+        return seen;
+    }
+
+    std::vector<bool> dfs(u32 source) const {
+        return dfs(source, [](u32) {});
+    }
+
+private:
+    std::vector<u32> m_offsets;
+    std::vector<Edge> m_edges;
+};
+
+
+namespace geometry {
+
+// Simple polygon on the integer lattice, built one vertex at a time. The
+// polygon is implicitly closed from the last vertex back to the first, and
+// repeating the first vertex at the end is harmless. Sums are accumulated in
+// 128 bits so coordinates may use the full `i64` range.
+class LatticePolygon {
+public:
+    void push(i64 x, i64 y) {
+        if (m_count == 0) {
+            m_first_x = x;
+            m_first_y = y;
+        } else {
+            addEdge(m_last_x, m_last_y, x, y, m_area2, m_boundary);
+        }
+        m_last_x = x;
+        m_last_y = y;
+        ++m_count;
+    }
+
+    template<typename T>
+    void push(const std::complex<T> &v) { push(v.real(), v.imag()); }
+
+    usize size() const { return m_count; }
+
+    // Twice the area (shoelace formula)
+    i128 area2() const {
+        i128 area2 = m_area2, boundary = m_boundary;
+        addEdge(m_last_x, m_last_y, m_first_x, m_first_y, area2, boundary);
+        return area2 < 0 ? -area2 : area2;
+    }
+
+    // Lattice points on the edges
+    i128 boundary() const {
+        i128 area2 = m_area2, boundary = m_boundary;
+        addEdge(m_last_x, m_last_y, m_first_x, m_first_y, area2, boundary);
+        return boundary;
+    }
+
+    // Lattice points strictly inside (Pick's theorem, A = I + B/2 - 1)
+    i128 interior() const {
+        return (area2() - boundary()) / 2 + 1;
+    }
+
+private:
+    i64 m_first_x = 0;
+    i64 m_first_y = 0;
+    i64 m_last_x = 0;
+    i64 m_last_y = 0;
+    usize m_count = 0;
+    i128 m_area2 = 0;
+    i128 m_boundary = 0;
+
+    static void addEdge(i64 x1, i64 y1, i64 x2, i64 y2, i128 &area2, i128 &boundary) {
+        area2 += (i128)x1 * y2 - (i128)x2 * y1;
+        const u64 dx = x2 > x1 ? (u64)x2 - (u64)x1 : (u64)x1 - (u64)x2;
+        const u64 dy = y2 > y1 ? (u64)y2 - (u64)y1 : (u64)y1 - (u64)y2;
+        boundary += std::gcd(dx, dy);
+    }
+};
+
+} // namespace geometry
+
 } // namespace utils
 
 namespace std
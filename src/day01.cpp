@@ -5,14 +5,26 @@
 #include <string>
 #include <numeric>
 #include <cstdint>
+#include <cstring>
+#include <array>
+#include <string_view>
+#include <thread>
+#include <chrono>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "recycles.h"
 
 
-typedef std::vector<std::string> input_t;
+typedef std::string input_t;
 
 const uint32_t DAY = 1; 
 
-const char* NUMBER_NAMES[9] = {"one", "two", "three", "four",
-                               "five", "six", "seven", "eight", "nine"};
+constexpr std::array<std::string_view, 9> NUMBER_NAMES = {"one", "two", "three", "four",
+                                                         "five", "six", "seven", "eight", "nine"};
 
 #ifdef _DEBUG
 #define INPUT_FILE "data/examples/01.txt"
@@ -20,135 +32,328 @@ const char* NUMBER_NAMES[9] = {"one", "two", "three", "four",
 #define INPUT_FILE "data/01.txt"
 #endif
 
-input_t parse_inputs(){
-    std::ifstream file(INPUT_FILE);
+void usage(const std::string &program_name) {
+    std::cout << "Usage: " << program_name << " [<input_file> | - | -f <input_file>]\n"
+              << "  <input_file>     solve the file (default \"" INPUT_FILE "\")\n"
+              << "  -                stream lines from stdin\n"
+              << "  -f <input_file>  follow a growing file, printing the sums as lines are appended\n";
+}
+
+
+input_t parse_inputs(const std::string &filename){
+    std::ifstream file(filename);
     if (!file) {
-        std::cerr << "Unable to open file \"" << INPUT_FILE << "\"!" << std::endl;
+        std::cerr << "Unable to open file \"" << filename << "\"!" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    input_t lines;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        lines.emplace_back(std::move(line));
-    }
+    std::ostringstream oss;
+    oss << file.rdbuf();
     
     file.close();
-    return lines;
+    return oss.str();
 }
 
 
-int get_number_from_name(std::string &substr) {
-    for (size_t i = 0; i < 9; ++i) {
-        if (substr.find(NUMBER_NAMES[i]) != std::string::npos) {
-            return i+1;
+// Aho-Corasick automaton matching the spelled-out `NUMBER_NAMES` and the
+// digits as a DFA, one table load per byte. The trie states come first, then
+// one state per digit `0`-`9` that behaves like the root.
+constexpr size_t NAME_STATES = 1 + 3+3+5+4+4+3+5+5+4;
+constexpr size_t DIGIT_STATE = NAME_STATES;
+constexpr size_t STATES = NAME_STATES + 10;
+constexpr uint8_t NO_MATCH = 0xFF;
+
+struct Automaton {
+    uint8_t next[STATES][256];
+    uint8_t value[STATES];  // digit matched when entering the state, or `NO_MATCH`
+};
+
+
+// `reverse` builds the automaton of the mirrored names, for scanning a line
+// from its end.
+constexpr Automaton build_automaton(bool reverse) {
+    Automaton a{};
+    int16_t child[STATES][256]{};
+    uint8_t fail[STATES]{};
+    for (auto &row : child) {
+        for (auto &c : row) c = -1;
+    }
+    for (auto &v : a.value) v = NO_MATCH;
+
+    // Trie of the names
+    uint8_t count = 1;
+    for (size_t i = 0; i < NUMBER_NAMES.size(); ++i) {
+        const std::string_view name = NUMBER_NAMES[i];
+        uint8_t state = 0;
+        for (size_t j = 0; j < name.size(); ++j) {
+            const uint8_t c = reverse ? name[name.size() - 1 - j] : name[j];
+            if (child[state][c] == -1) child[state][c] = count++;
+            state = child[state][c];
         }
+        a.value[state] = i + 1;
     }
-    return -1;
+
+    // Failure links in BFS order turn the trie into a DFA
+    uint8_t queue[NAME_STATES]{};
+    size_t head = 0, tail = 0;
+    for (size_t c = 0; c < 256; ++c) {
+        if (child[0][c] != -1) {
+            a.next[0][c] = child[0][c];
+            queue[tail++] = child[0][c];
+        }
+    }
+    while (head < tail) {
+        const uint8_t s = queue[head++];
+        for (size_t c = 0; c < 256; ++c) {
+            if (child[s][c] == -1) {
+                a.next[s][c] = a.next[fail[s]][c];
+                continue;
+            }
+            const uint8_t t = child[s][c];
+            fail[t] = a.next[fail[s]][c];
+            if (a.value[t] == NO_MATCH) a.value[t] = a.value[fail[t]];
+            a.next[s][c] = t;
+            queue[tail++] = t;
+        }
+    }
+
+    // Digits match from anywhere and restart the names
+    for (size_t d = 0; d < 10; ++d) {
+        a.value[DIGIT_STATE + d] = d;
+        for (size_t s = 0; s < NAME_STATES; ++s) {
+            a.next[s]['0' + d] = DIGIT_STATE + d;
+        }
+    }
+    for (size_t d = 0; d < 10; ++d) {
+        for (size_t c = 0; c < 256; ++c) {
+            a.next[DIGIT_STATE + d][c] = a.next[0][c];
+        }
+    }
+    return a;
 }
 
+constexpr Automaton FORWARD = build_automaton(false);
+constexpr Automaton BACKWARD = build_automaton(true);
 
-int part1() {
-    input_t inputs = parse_inputs();
 
-    std::vector<int32_t> numbers;
-    int num;
+struct Calibration {
+    uint64_t part1;
+    uint64_t part2;
+};
 
-    for (size_t i = 0; i < inputs.size(); ++i) {
-        num = 0;
-        for (char c : inputs[i]) {
-            if (std::isdigit(c)) {
-                num += (c - 0x30) * 10;
-                break;
-            }
-        }
 
-         for (size_t j = inputs[i].size() - 1; j >= 0; --j) {
-            char c = inputs[i][j];
-            if (std::isdigit(c)) {
-                num += c - 0x30;
-                break;
-            }
-        }
+// Minimum number of bytes given to a worker thread
+constexpr size_t MIN_CHUNK = 1 << 20;
 
-        #ifdef _DEBUG
-            std::cout << num << std::endl;
-        #endif
-        numbers.emplace_back(num);
-    }
 
-    #ifdef _DEBUG
-        std::cout << "\n";
+inline bool is_digit(unsigned char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+
+#if defined(__SSE2__)
+// Bitmask of the digit bytes among `p[0..16)`
+inline uint32_t digit_mask(const unsigned char *p) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    const __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    return _mm_movemask_epi8(digits);
+}
+#endif
+
+
+// First digit in `[begin, end)`, or `end`
+const unsigned char *find_first_digit(const unsigned char *begin, const unsigned char *end) {
+    #if defined(__SSE2__)
+    for (; end - begin >= 16; begin += 16) {
+        if (uint32_t m = digit_mask(begin)) return begin + std::countr_zero(m);
+    }
     #endif
+    for (; begin < end; ++begin) {
+        if (is_digit(*begin)) return begin;
+    }
+    return end;
+}
 
-    const int sum = std::accumulate(numbers.begin(), numbers.end(), 0);
-    return sum;
+
+// Last digit in `[begin, end)`, or `end`
+const unsigned char *find_last_digit(const unsigned char *begin, const unsigned char *end) {
+    const unsigned char *p = end;
+    #if defined(__SSE2__)
+    for (; p - begin >= 16; p -= 16) {
+        if (uint32_t m = digit_mask(p - 16)) return p - 16 + (31 - std::countl_zero(m));
+    }
+    #endif
+    while (p > begin) {
+        if (is_digit(*--p)) return p;
+    }
+    return end;
 }
 
 
-int part2() {
-    input_t inputs = parse_inputs();
+// First number name in `[begin, end)` scanning forward with `FORWARD`, or
+// backward with `BACKWARD`. The range must not contain digits.
+template<bool forward>
+uint8_t find_name(const unsigned char *begin, const unsigned char *end) {
+    const Automaton &a = forward ? FORWARD : BACKWARD;
+    uint8_t state = 0;
+    for (ptrdiff_t i = 0, n = end - begin; i < n; ++i) {
+        state = a.next[state][forward ? begin[i] : end[-1 - i]];
+        if (a.value[state] != NO_MATCH) return a.value[state];
+    }
+    return NO_MATCH;
+}
 
-    std::vector<int32_t> numbers;
-    int num;
 
-    for (size_t i = 0; i < inputs.size(); ++i) {
-        num = 0;
-        for (size_t j = 0; j < inputs[i].size(); ++j) {
-            char c = inputs[i][j];
-            if (std::isdigit(c)) {
-                num += 10*(c - 0x30);
-                break;
-            }
+// Digits are located with SIMD, the automata only scan the bytes before the
+// first digit and after the last one.
+Calibration calibrate_chunk(std::string_view chunk) {
+    Calibration sum{0, 0};
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(chunk.data());
+    const unsigned char *const end = p + chunk.size();
 
-            std::string substr = inputs[i].substr(0, j+1);
-            int number = get_number_from_name(substr);
-            if (number != -1) {
-                num += 10*number; 
-                break;
-            }
-        }
+    while (p < end) {
+        const unsigned char *eol = static_cast<const unsigned char *>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
 
-        for (size_t j = inputs[i].size()-1; j >= 0; --j) {
-            char c = inputs[i][j];
-            if (std::isdigit(c)) {
-                num += c - 0x30;
-                break;
-            }
+        const unsigned char *first = find_first_digit(p, eol);
+        const unsigned char *last = first == eol ? eol : find_last_digit(first, eol);
+        const uint32_t d1 = first != eol ? *first - '0' : 0;
+        const uint32_t d2 = last != eol ? *last - '0' : 0;
+        const uint8_t n1 = find_name<true>(p, first);
+        const uint8_t n2 = find_name<false>(last != eol ? last + 1 : p, eol);
 
-            std::string substr = inputs[i].substr(j, inputs[i].size());
-            int number = get_number_from_name(substr);
-            if (number != -1) {
-                num += number;
-                break;
-            }
-        }
+        sum.part1 += 10*d1 + d2;
+        sum.part2 += 10*(n1 != NO_MATCH ? n1 : d1) + (n2 != NO_MATCH ? n2 : d2);
 
         #ifdef _DEBUG
-            std::cout << inputs[i] << ": " << num << std::endl;
+            std::cout << std::string_view(reinterpret_cast<const char *>(p), eol - p) << ": "
+                      << 10*d1 + d2 << ", "
+                      << 10*(n1 != NO_MATCH ? n1 : d1) + (n2 != NO_MATCH ? n2 : d2) << std::endl;
         #endif
-        numbers.emplace_back(num);
+        p = eol + 1;
     }
-    #ifdef _DEBUG
-        std::cout << "\n";
-    #endif
 
-    const int sum = std::accumulate(numbers.begin(), numbers.end(), 0);
+    return sum;
+}
 
+
+// Both parts in a single pass. Large inputs are split into one chunk per
+// hardware thread, each taking the lines that start in its byte range.
+Calibration calibrate(std::string_view input) {
+    // Start of the first line beginning at or after `pos`
+    auto line_start = [input](size_t pos) {
+        if (pos == 0 || pos >= input.size()) return std::min(pos, input.size());
+        const size_t eol = input.find('\n', pos - 1);
+        return eol == std::string_view::npos ? input.size() : eol + 1;
+    };
+
+    const size_t workers = utils::workerCount(input.size(), MIN_CHUNK);
+    std::vector<Calibration> partial(workers);
+    utils::forEachChunk(input.size(), workers, [&](size_t w, size_t first, size_t last) {
+        first = line_start(first);
+        partial[w] = calibrate_chunk(input.substr(first, line_start(last) - first));
+    });
+
+    Calibration sum{0, 0};
+    for (const Calibration &c : partial) {
+        sum.part1 += c.part1;
+        sum.part2 += c.part2;
+    }
     return sum;
 }
 
 
-int main() 
+// Running sums over calibration lines fed one at a time. Nothing but the
+// sums is kept between lines.
+class CalibrationStream {
+public:
+    void push(std::string_view line) {
+        const Calibration c = calibrate_chunk(line);
+        m_sum.part1 += c.part1;
+        m_sum.part2 += c.part2;
+        ++m_lines;
+    }
+
+    const Calibration& sum() const { return m_sum; }
+
+    uint64_t lines() const { return m_lines; }
+
+private:
+    Calibration m_sum{0, 0};
+    uint64_t m_lines = 0;
+};
+
+
+// Reads lines from `is` until the end of the stream. Every time the lines
+// read so far are used up (the next read would wait for more input) the sums
+// are printed, so a pipe shows them as batches come in. With `follow`, the
+// end of the stream only means "no new lines yet" and the stream is polled
+// again, like `tail -f`. A trailing line without a newline is held back until
+// it's completed.
+Calibration stream_calibrate(std::istream &is, bool follow) {
+    CalibrationStream cs;
+    std::string pending;
+    std::string line;
+    uint64_t reported = 0;
+
+    auto report = [&]() {
+        if (cs.lines() == reported) return;
+        reported = cs.lines();
+        std::cout << "lines = " << cs.lines() << ", part 1 = " << cs.sum().part1
+                  << ", part 2 = " << cs.sum().part2 << std::endl;
+    };
+
+    while (!is.bad()) {
+        std::getline(is, line);
+        if (!is.eof()) {
+            pending += line;
+            cs.push(pending);
+            pending.clear();
+            if (is.rdbuf()->in_avail() <= 0) report();
+            continue;
+        }
+
+        pending += line;
+        if (!follow) break;
+        report();
+        is.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    if (!pending.empty()) cs.push(pending);
+    return cs.sum();
+}
+
+
+int main(int argc, char *argv[]) 
 {
-    int res1 = part1();
-    int res2 = part2();
+    Calibration res;
+    const std::string arg = argc > 1 ? argv[1] : INPUT_FILE;
+    if (arg == "-") {
+        // Buffered std::cin, so that in_avail() tells when a batch is used up
+        std::ios::sync_with_stdio(false);
+        res = stream_calibrate(std::cin, false);
+    } else if (arg == "-f") {
+        if (argc < 3) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        std::ifstream file(argv[2]);
+        if (!file) {
+            std::cerr << "Unable to open file \"" << argv[2] << "\"!" << std::endl;
+            return EXIT_FAILURE;
+        }
+        res = stream_calibrate(file, true);
+    } else {
+        input_t inputs = parse_inputs(arg);
+        res = calibrate(inputs);
+    }
 
     std::cout << "---PART 1---\n";
-    std::cout << "Sum = " << res1 << std::endl;
+    std::cout << "Sum = " << res.part1 << std::endl;
     std::cout << "---PART 2---\n";
-    std::cout << "Sum = " << res2 << std::endl;
+    std::cout << "Sum = " << res.part2 << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -3,17 +3,33 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <numeric>
+#include <cstdint>
+#include <algorithm>
+#include <span>
 
 
-typedef std::vector<std::string> input_t;
+// Maximum count of every colour drawn in each game, one column per colour.
+// Game ids are implicit: game i+1 lives at index i.
+struct Games {
+    std::vector<uint32_t> max_red;
+    std::vector<uint32_t> max_green;
+    std::vector<uint32_t> max_blue;
+
+    size_t size() const { return max_red.size(); }
+};
+
+typedef Games input_t;
 
 
 void usage(const std::string &program_name) {
-    std::cout << "Usage: " << program_name << " <input_file>\n";
+    std::cout << "Usage: " << program_name << " <input_file> [<limits_file>]\n";
+    std::cout << "  <limits_file>  one \"<red> <green> <blue>\" bag limit per line\n";
 }
 
 
+// Single pass over the raw bytes: after the "Game N:" header every draw is
+// "<count> <colour>", and the first letter of the colour is enough to tell
+// red, green and blue apart.
 input_t parse_inputs(const std::string &filename){
     std::ifstream file(filename);
     if (!file) {
@@ -21,89 +37,193 @@ input_t parse_inputs(const std::string &filename){
         exit(EXIT_FAILURE);
     }
 
-    input_t lines;
-    std::string line;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+    file.close();
+
+    input_t games;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end) {
+        const char *eol = std::find(p, end, '\n');
+        p = std::find(p, eol, ':');
+        if (p == eol) {     // blank line
+            p = eol + 1;
+            continue;
+        }
 
-    while (std::getline(file, line)) {
-        lines.emplace_back(std::move(line));
+        uint32_t max[3] = {0, 0, 0};
+        while (p < eol) {
+            while (p < eol && (*p < '0' || *p > '9')) ++p;
+            if (p == eol) break;
+            uint32_t count = 0;
+            while (*p >= '0' && *p <= '9') count = count * 10 + (*p++ - '0');
+            ++p;            // ' '
+            const int colour = (*p == 'g') + 2 * (*p == 'b');
+            max[colour] = std::max(max[colour], count);
+            p += 3;         // shortest colour name
+        }
+        games.max_red.push_back(max[0]);
+        games.max_green.push_back(max[1]);
+        games.max_blue.push_back(max[2]);
+        p = eol + 1;
     }
-    
-    file.close();
-    return lines;
+
+    return games;
 }
 
 
-int part1(const input_t& in) {
-    std::vector<int> possible_games;
-    for (int i = 0; i < in.size(); ++i) {
-        std::stringstream game_ss(in[i]);
-
-        bool possible=true;
-        int game = i+1;
-        const int MAX_RED  =12;
-        const int MAX_GREEN=13;
-        const int MAX_BLUE =14;
-
-        std::string set;
-        std::getline(game_ss, set, ':');
-        while (std::getline(game_ss, set, ';') && possible) {
-            std::stringstream set_ss(set);
-            std::string color;
-            while (std::getline(set_ss, color, ',') && possible) {
-                color.erase(0, 1);
-                std::stringstream color_ss(color);
-                std::string color_value_str;
-                std::getline(color_ss, color_value_str, ' ');
-                int color_val = std::stoi(color_value_str);
-                std::string color_name;
-                std::getline(color_ss, color_name, ' ');
-
-                if      (color_name == "red"   && color_val > MAX_RED)   possible=false;
-                else if (color_name == "green" && color_val > MAX_GREEN) possible=false;
-                else if (color_name == "blue"  && color_val > MAX_BLUE)  possible=false;
+struct BagLimit {
+    uint32_t red;
+    uint32_t green;
+    uint32_t blue;
+};
+
+
+// Weighted 2D dominance counting over a static point set: sum of the weights
+// of all points with key <= k and value <= v in O(log^2 n). Points are sorted
+// by key and Fenwick node j keeps the values of its range (j - lowbit(j), j]
+// sorted, together with the running sum of their weights.
+class Dominance2D {
+public:
+    struct Point {
+        uint32_t key;
+        uint32_t value;
+        int64_t weight;
+    };
+
+    Dominance2D() = default;
+
+    explicit Dominance2D(std::vector<Point> points) {
+        std::sort(points.begin(), points.end(),
+                  [](const Point &a, const Point &b) { return a.key < b.key; });
+        const size_t n = points.size();
+        keys.resize(n);
+        offset.resize(n + 2, 0);
+        for (size_t j = 1; j <= n; ++j) {
+            keys[j - 1] = points[j - 1].key;
+            offset[j + 1] = offset[j] + (j & -j);
+        }
+
+        values.resize(offset[n + 1]);
+        sums.resize(offset[n + 1]);
+        for (size_t j = 1; j <= n; ++j) {
+            const size_t first = j - (j & -j);
+            std::vector<Point> node(points.begin() + first, points.begin() + j);
+            std::sort(node.begin(), node.end(),
+                      [](const Point &a, const Point &b) { return a.value < b.value; });
+            int64_t sum = 0;
+            for (size_t i = 0; i < node.size(); ++i) {
+                sum += node[i].weight;
+                values[offset[j] + i] = node[i].value;
+                sums[offset[j] + i] = sum;
+            }
+        }
+    }
+
+    int64_t query(uint32_t max_key, uint32_t max_value) const {
+        size_t j = std::upper_bound(keys.begin(), keys.end(), max_key) - keys.begin();
+        int64_t sum = 0;
+        for (; j > 0; j -= j & -j) {
+            const auto first = values.begin() + offset[j];
+            const auto last = values.begin() + offset[j + 1];
+            const size_t count = std::upper_bound(first, last, max_value) - first;
+            if (count) sum += sums[offset[j] + count - 1];
+        }
+        return sum;
+    }
+
+private:
+    std::vector<uint32_t> keys;     // sorted
+    std::vector<size_t> offset;     // start of Fenwick node j in values/sums
+    std::vector<uint32_t> values;
+    std::vector<int64_t> sums;
+};
+
+
+// Sum of the ids of the games that fit in a bag, for any bag. Built once in
+// O(n log^2 n) time and memory; every query is O(log^3 n). The outer Fenwick
+// tree runs over the games sorted by red, each of its nodes a 2D dominance
+// structure on (green, blue).
+class BagIndex {
+public:
+    explicit BagIndex(const Games &games) {
+        std::vector<size_t> order(games.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(),
+                  [&](size_t a, size_t b) { return games.max_red[a] < games.max_red[b]; });
+
+        const size_t n = order.size();
+        reds.resize(n);
+        nodes.resize(n + 1);
+        for (size_t j = 1; j <= n; ++j) {
+            reds[j - 1] = games.max_red[order[j - 1]];
+            std::vector<Dominance2D::Point> points;
+            for (size_t r = j - (j & -j); r < j; ++r) {
+                const size_t game = order[r];
+                points.push_back({games.max_green[game], games.max_blue[game], (int64_t)game + 1});
             }
+            nodes[j] = Dominance2D(std::move(points));
+        }
+    }
+
+    int64_t query(const BagLimit &bag) const {
+        size_t j = std::upper_bound(reds.begin(), reds.end(), bag.red) - reds.begin();
+        int64_t sum = 0;
+        for (; j > 0; j -= j & -j) {
+            sum += nodes[j].query(bag.green, bag.blue);
         }
+        return sum;
+    }
+
+    std::vector<int64_t> query(std::span<const BagLimit> bags) const {
+        std::vector<int64_t> sums(bags.size());
+        for (size_t i = 0; i < bags.size(); ++i) {
+            sums[i] = query(bags[i]);
+        }
+        return sums;
+    }
+
+private:
+    std::vector<uint32_t> reds;     // sorted
+    std::vector<Dominance2D> nodes;
+};
+
+
+std::vector<BagLimit> parse_limits(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Unable to open file \"" << filename << "\"!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-        if (possible) possible_games.push_back(game);
+    std::vector<BagLimit> bags;
+    BagLimit bag;
+    while (file >> bag.red >> bag.green >> bag.blue) {
+        bags.push_back(bag);
     }
+    return bags;
+}
 
-    return std::accumulate(possible_games.begin(), possible_games.end(), 0);
+
+int part1(const BagIndex& index) {
+    const uint32_t MAX_RED  =12;
+    const uint32_t MAX_GREEN=13;
+    const uint32_t MAX_BLUE =14;
+    return (int)index.query(BagLimit{MAX_RED, MAX_GREEN, MAX_BLUE});
 }
 
 int part2(const input_t& in) {
-    std::vector<int> powers;
-    for (int i = 0; i < in.size(); ++i) {
-        int32_t max_red   = 0;
-        int32_t max_green = 0;
-        int32_t max_blue  = 0;
-
-        std::stringstream game_ss(in[i]);
-        std::string set;
-        std::getline(game_ss, set, ':');
-        while (std::getline(game_ss, set, ';')) {
-            std::stringstream set_ss(set);
-            std::string color;
-            while (std::getline(set_ss, color, ',')) {
-                color.erase(0, 1);
-                std::stringstream color_ss(color);
-                std::string color_value_str;
-                std::getline(color_ss, color_value_str, ' ');
-                int color_val = std::stoi(color_value_str);
-                std::string color_name;
-                std::getline(color_ss, color_name, ' ');
-
-                if      (color_name == "red")   max_red   = std::max(max_red,   color_val);
-                else if (color_name == "green") max_green = std::max(max_green, color_val);
-                else if (color_name == "blue")  max_blue  = std::max(max_blue,   color_val);
-            }
-        }
-        powers.push_back(max_blue * max_green * max_red);
+    int sum = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
 #ifdef _DEBUG
-        std::cout << "Game " << i+1 << ": " << max_red << "," << max_green << "," << max_blue << "; "
-            << max_red*max_blue*max_green << std::endl;
+        std::cout << "Game " << i+1 << ": " << in.max_red[i] << "," << in.max_green[i] << "," << in.max_blue[i] << "; "
+            << in.max_red[i]*in.max_blue[i]*in.max_green[i] << std::endl;
 #endif
+        sum += in.max_red[i] * in.max_green[i] * in.max_blue[i];
     }
-    return std::accumulate(powers.begin(), powers.end(), 0);
+    return sum;
 }
 
 int main(int argc, char *argv[]) {
@@ -112,13 +232,24 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    input_t lines = parse_inputs(argv[1]);
-    int res1 = part1(lines);
-    int res2 = part2(lines);
+    input_t games = parse_inputs(argv[1]);
+    const BagIndex index(games);
+    int res1 = part1(index);
+    int res2 = part2(games);
 
     std::cout << "-----PART 1-----\n";
     std::cout << "Sum = " << res1 << std::endl;
     std::cout << "-----PART 2-----\n";
     std::cout << "Sum = " << res2 << std::endl;
+
+    if (argc > 2) {
+        const std::vector<BagLimit> bags = parse_limits(argv[2]);
+        const std::vector<int64_t> sums = index.query(bags);
+        std::cout << "-----LIMITS-----\n";
+        for (size_t i = 0; i < bags.size(); ++i) {
+            std::cout << bags[i].red << " " << bags[i].green << " " << bags[i].blue
+                      << ": Sum = " << sums[i] << std::endl;
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -3,13 +3,43 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <numeric>
-#include <optional>
-#include <complex>
 
+#include "recycles.h"
 
-typedef std::vector<std::string> input_t;
+
+// A run of digits on one row, columns [first, last)
+struct Number {
+    int row;
+    int first;
+    int last;
+    int64_t value;
+};
+
+
+// The schematic plus a label grid holding, for every cell, the id of the
+// number covering it (or NO_NUMBER). The label grid has a one cell border so
+// neighbourhood lookups never need bound checks.
+struct Schematic {
+    static constexpr int32_t NO_NUMBER = -1;
+
+    int rows = 0;
+    int cols = 0;
+    std::vector<std::string> lines;
+    std::vector<Number> numbers;
+    std::vector<int32_t> labels;
+
+    int32_t label(int row, int col) const { return labels[(row + 1) * (cols + 2) + col + 1]; }
+    int32_t& label(int row, int col) { return labels[(row + 1) * (cols + 2) + col + 1]; }
+};
+
+typedef Schematic input_t;
+
+
+// Minimum number of cells given to a worker thread
+constexpr size_t MIN_BAND = 1 << 20;
 
 
 void usage(const std::string &program_name) {
@@ -17,6 +47,72 @@ void usage(const std::string &program_name) {
 }
 
 
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static bool is_symbol(char c) { return c != '.' && !is_digit(c); }
+
+
+// One band per hardware thread, by cell count, and at most one per row
+size_t band_workers(const Schematic &s) {
+    const size_t cells = (size_t)s.rows * s.cols;
+    return std::min<size_t>(utils::workerCount(cells, MIN_BAND), std::max(s.rows, 1));
+}
+
+
+// Digit runs starting on rows [first, last)
+size_t count_numbers(const Schematic &s, int first, int last) {
+    size_t count = 0;
+    for (int i = first; i < last; ++i) {
+        const std::string &line = s.lines[i];
+        for (int j = 0; j < s.cols; ++j) {
+            count += is_digit(line[j]) && (j == 0 || !is_digit(line[j - 1]));
+        }
+    }
+    return count;
+}
+
+
+// Scan over rows [first, last): every digit run gets the next id, starting
+// at `id`, and its value is accumulated as it is read.
+void label_band(Schematic &s, int first, int last, int32_t id) {
+    for (int i = first; i < last; ++i) {
+        const std::string &line = s.lines[i];
+        for (int j = 0; j < s.cols;) {
+            if (!is_digit(line[j])) {
+                ++j;
+                continue;
+            }
+            Number num{i, j, j, 0};
+            for (; j < s.cols && is_digit(line[j]); ++j) {
+                num.value = num.value * 10 + (line[j] - '0');
+                s.label(i, j) = id;
+            }
+            num.last = j;
+            s.numbers[id++] = num;
+        }
+    }
+}
+
+
+// Numbers never span rows, so each band labels the numbers of its own rows
+// and no halo is needed. Ids stay in row order: a first pass counts the
+// numbers of every band, and each band's ids start past those of the bands
+// above it.
+void label_numbers(Schematic &s) {
+    s.labels.assign((s.rows + 2) * (s.cols + 2), Schematic::NO_NUMBER);
+    const size_t workers = band_workers(s);
+    std::vector<size_t> start(workers + 1, 0);
+    utils::forEachChunk(s.rows, workers, [&](size_t w, size_t first, size_t last) {
+        start[w + 1] = count_numbers(s, first, last);
+    });
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    s.numbers.resize(start[workers]);
+    utils::forEachChunk(s.rows, workers, [&](size_t w, size_t first, size_t last) {
+        label_band(s, first, last, start[w]);
+    });
+}
+
+
 input_t parse_inputs(const std::string &filename) {
     std::ifstream file(filename);
     if (!file) {
@@ -24,119 +120,160 @@ input_t parse_inputs(const std::string &filename) {
         exit(EXIT_FAILURE);
     }
 
-    input_t lines;
+    input_t schematic;
     std::string line;
 
     while (std::getline(file, line)) {
-        if (line[line.size()] == '\r') line.pop_back();
-        lines.emplace_back(std::move(line));
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        schematic.cols = std::max<int>(schematic.cols, line.size());
+        schematic.lines.emplace_back(std::move(line));
     }
-    
     file.close();
-    std::cout << std::endl;
-    return lines;
+
+    schematic.rows = schematic.lines.size();
+    for (auto &l : schematic.lines) l.resize(schematic.cols, '.');
+    label_numbers(schematic);
+    return schematic;
 }
 
 
-bool check_neighbors(int px, int py, const input_t &in) {
-    for (int i = std::max(px-1, 0); i <= px + 1 && i < in.size() ; i++) {
-        for (int j = std::max(py-1, 0); j <= py + 1 && j < in[i].size(); j++) {
-            char c = in[i][j];
-            if (c != '.' && !std::isdigit(c)) {
-                return true;
-            } 
+// Unique ids of the numbers touching cell (row, col), returns how many there
+// are (at most two per row, so six in total). Cells of the same number are
+// contiguous on a row and a number never spans rows, so dropping repeats of
+// the previous cell is enough.
+int adjacent_numbers(const Schematic &s, int row, int col, int32_t ids[6]) {
+    int count = 0;
+    for (int i = row - 1; i <= row + 1; ++i) {
+        int32_t prev = Schematic::NO_NUMBER;
+        for (int j = col - 1; j <= col + 1; ++j) {
+            const int32_t id = s.label(i, j);
+            if (id != Schematic::NO_NUMBER && id != prev) ids[count++] = id;
+            prev = id;
         }
     }
-    return false;
+    return count;
 }
 
 
-int part1(const input_t &in) {
-    std::vector<int> valid_parts;
-    char buf[64];
-    size_t idx = 0;
-    bool valid_part = false;
-    for (int i = 0; i < in.size(); ++i) {
-        const std::string &line = in[i];
+// One bit per cell, rows of `words` 64-bit words. Bit j of a row is cell j.
+struct RowMasks {
+    int words = 0;
+    std::vector<uint64_t> bits;
+
+    RowMasks(int rows, int cols) : words((cols + 63) / 64), bits(rows * words, 0) {}
+
+    uint64_t* row(int r) { return bits.data() + r * words; }
+    const uint64_t* row(int r) const { return bits.data() + r * words; }
+};
+
 
-        if (idx != 0 && valid_part) {
-            buf[idx] = '\0';
-            valid_parts.emplace_back(std::stoi(buf));
-            valid_part = false;
+// Symbols of rows [first, last), row 0 of the mask being row `first`
+RowMasks symbol_mask(const input_t &in, int first, int last) {
+    RowMasks mask(last - first, in.cols);
+    for (int i = first; i < last; ++i) {
+        uint64_t *row = mask.row(i - first);
+        for (int j = 0; j < in.cols; ++j) {
+            row[j / 64] |= (uint64_t)is_symbol(in.lines[i][j]) << (j % 64);
         }
-        memset(buf, 0xff, 64);
-        idx = 0;
-        for (int j = 0; j < line.size(); ++j) {
-            char c = line[j];
-            if (std::isdigit(c)) {
-                buf[idx++] = c;
-                if (!valid_part) 
-                    valid_part = check_neighbors(i, j, in);
-                continue;
-            }
-            if (idx != 0 && valid_part) {
-                buf[idx] = '\0';
-                valid_parts.emplace_back(std::stoi(buf));
-                valid_part = false;
-            }
-            idx = 0;
-            memset(buf, 0xff, 64);
+    }
+    return mask;
+}
+
+
+// Cells within one step (diagonals included) of a set cell: shift-or by one
+// in x, then OR each row with the ones above and below. Plain word loops so
+// the compiler can vectorize them.
+RowMasks dilate(const RowMasks &mask, int rows) {
+    const int words = mask.words;
+    RowMasks wide = mask;
+    for (int i = 0; i < rows; ++i) {
+        const uint64_t *src = mask.row(i);
+        uint64_t *dst = wide.row(i);
+        for (int w = 0; w < words; ++w) {
+            const uint64_t prev = w > 0 ? src[w - 1] : 0;
+            const uint64_t next = w + 1 < words ? src[w + 1] : 0;
+            dst[w] = src[w] | (src[w] << 1) | (prev >> 63) | (src[w] >> 1) | (next << 63);
         }
     }
 
-    return std::accumulate(valid_parts.begin(), valid_parts.end(), 0);
+    RowMasks near = mask;
+    for (int i = 0; i < rows; ++i) {
+        const uint64_t *mid = wide.row(i);
+        const uint64_t *up = i > 0 ? wide.row(i - 1) : mid;
+        const uint64_t *down = i + 1 < rows ? wide.row(i + 1) : mid;
+        uint64_t *dst = near.row(i);
+        for (int w = 0; w < words; ++w) {
+            dst[w] = up[w] | mid[w] | down[w];
+        }
+    }
+    return near;
 }
 
 
-int get_num(int py, int &px, const input_t &in) {
-    char num[4] = {0x30, 0x30, 0x30, 0};
-    int p1 = px;
-    int p2 = px;
-
-    for (;isdigit(in[py][p1]) && p1 >= 0; p1--){}
-    for (;isdigit(in[py][p2]) && p2 < in[0].size(); p2++){}
-    
-    for (int i = p1+1; i < p2; i++) {
-        num[i-p1-1] = in[py][i];
+// Any bit set in columns [first, last) of a row
+bool any_in_range(const uint64_t *row, int first, int last) {
+    for (int w = first / 64; w * 64 < last; ++w) {
+        const int lo = std::max(first - w * 64, 0);
+        const int hi = std::min(last - w * 64, 64);
+        const uint64_t range = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & (~0ULL << lo);
+        if (row[w] & range) return true;
     }
+    return false;
+}
+
 
-    px = p2;
-    num[p2-p1-1] = '\0';
-    return std::stoi(num);
+// Splits the rows in one band per hardware thread and sums `band(first, last)`
+// over all of them. Bands read one halo row on each side, but a number or a
+// gear only counts in the band holding its row, so nothing is counted twice.
+template<typename F>
+int64_t sum_bands(const input_t &in, F band) {
+    const size_t workers = band_workers(in);
+    std::vector<int64_t> partial(workers);
+    utils::forEachChunk(in.rows, workers, [&](size_t w, size_t first, size_t last) {
+        partial[w] = band(first, last);
+    });
+    return std::accumulate(partial.begin(), partial.end(), int64_t(0));
 }
 
-int get_gear_ratio(int py, int px, const input_t &in) {
-    int neighbors[2] = {0, 0};
-    size_t nneighbors = 0;
 
-    for (int i = std::max(py-1, 0); i <= py + 1 && i < in.size() ; i++) {
-        for (int j = std::max(px-1, 0); j <= px + 1 && j < in[0].size(); j++) {
-            char c = in[i][j];
-            if (std::isdigit(c)) {
-                neighbors[nneighbors++] = get_num(i, j, in);
-            } 
-        }
+int64_t part1_band(const input_t &in, int first, int last) {
+    const int halo_first = std::max(first - 1, 0);
+    const int halo_last = std::min(last + 1, in.rows);
+    const RowMasks near = dilate(symbol_mask(in, halo_first, halo_last), halo_last - halo_first);
+
+    auto num = std::lower_bound(in.numbers.begin(), in.numbers.end(), first,
+                                [](const Number &n, int row) { return n.row < row; });
+    int64_t sum = 0;
+    for (; num != in.numbers.end() && num->row < last; ++num) {
+        if (any_in_range(near.row(num->row - halo_first), num->first, num->last)) sum += num->value;
     }
-    return neighbors[0]*neighbors[1];
+    return sum;
+}
+
+
+int64_t part1(const input_t &in) {
+    return sum_bands(in, [&in](int first, int last) { return part1_band(in, first, last); });
 }
 
 
-int part2(const input_t &in) {
-    std::vector<int> gear_ratios;
-    for (int i = 0; i < in.size(); ++i) {
-        const std::string &line = in[i];
-        for (int j = 0; j < line.size(); ++j) {
-            char c = line[j];
-            if (c == '*') {
-                int gr = get_gear_ratio(i, j, in);
-                if (gr) {
-                    gear_ratios.push_back(gr);
-                }
+int64_t part2_band(const input_t &in, int first, int last) {
+    int64_t sum = 0;
+    int32_t ids[6];
+    for (int i = first; i < last; ++i) {
+        for (int j = 0; j < in.cols; ++j) {
+            if (in.lines[i][j] != '*') continue;
+            if (adjacent_numbers(in, i, j, ids) == 2) {
+                sum += in.numbers[ids[0]].value * in.numbers[ids[1]].value;
             }
         }
     }
+    return sum;
+}
+
 
-    return std::accumulate(gear_ratios.begin(), gear_ratios.end(), 0);
+int64_t part2(const input_t &in) {
+    return sum_bands(in, [&in](int first, int last) { return part2_band(in, first, last); });
 }
 
 
@@ -146,10 +283,10 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    input_t lines = parse_inputs(argv[1]);
+    input_t schematic = parse_inputs(argv[1]);
 
-    int res1 = part1(lines);
-    int res2 = part2(lines);
+    int64_t res1 = part1(schematic);
+    int64_t res2 = part2(schematic);
 
     std::cout << "-----PART 1-----\n";
     std::cout << "Sum = " << res1 << std::endl;
@@ -157,4 +294,4 @@ int main(int argc, char *argv[]) {
     std::cout << "Sum = " << res2 << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
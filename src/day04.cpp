@@ -1,14 +1,26 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <vector>
 #include <string>
 #include <cstdint>
 #include <numeric>
+#include <algorithm>
+#include <array>
+#include <bit>
 
 using namespace std;
 
-typedef std::vector<std::string> input_t;
+// Both sides of a card as 128-bit sets, number n being bit n%64 of word n/64
+struct Card {
+    static constexpr uint32_t MAX_NUMBER = 128;
+
+    uint64_t winning[2] = {0, 0};
+    uint64_t mine[2] = {0, 0};
+
+    int matches() const {
+        return popcount(winning[0] & mine[0]) + popcount(winning[1] & mine[1]);
+    }
+};
 
 
 void usage(const std::string &program_name) {
@@ -16,113 +28,105 @@ void usage(const std::string &program_name) {
 }
 
 
-std::string trim(const std::string& s) {
-    const int l = (int)s.length();
-    int a=0, b=l-1;
-    char c;
-    while(a<l && ((c=s[a])==' '||c=='\t'||c=='\n'||c=='\v'||c=='\f'||c=='\r'||c=='\0')) a++;
-    while(b>a && ((c=s[b])==' '||c=='\t'||c=='\n'||c=='\v'||c=='\f'||c=='\r'||c=='\0')) b--;
-    return s.substr(a, 1+b-a);
+Card parse_card(const string &line) {
+    Card card;
+    uint64_t *side = card.winning;
+    size_t i = line.find(':');
+    if (i == string::npos) return card;
+
+    for (++i; i < line.size(); ++i) {
+        const char c = line[i];
+        if (c == '|') {
+            side = card.mine;
+        } else if (c >= '0' && c <= '9') {
+            uint32_t num = 0;
+            for (; i < line.size() && line[i] >= '0' && line[i] <= '9'; ++i) {
+                num = std::min<uint32_t>(num * 10 + (line[i] - '0'), Card::MAX_NUMBER);
+            }
+            --i;
+            if (num >= Card::MAX_NUMBER) {
+                std::cerr << "Card numbers must be below " << Card::MAX_NUMBER << ": \"" << line << "\"" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            side[num / 64] |= 1ULL << (num % 64);
+        }
+    }
+    return card;
 }
 
-input_t parse_inputs(const std::string &filename) {
+
+// Calls `fn(card)` for every card of the file, parsing it line by line so
+// only one card is in memory at a time
+template<typename F>
+void for_each_card(const std::string &filename, F fn) {
     std::ifstream file(filename);
     if (!file) {
         std::cerr << "Unable to open file \"" << filename << "\"!" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    input_t lines;
     std::string line;
-
     while (std::getline(file, line)) {
-        lines.emplace_back(std::move(line));
+        if (line.find(':') != string::npos) fn(parse_card(line));
     }
-    
-    file.close();
-    return lines;
-}
 
-void get_card_nums(const string &line, vector<uint32_t> &winning_nums, vector<uint32_t> &my_nums) {
-    string line_trimmed = trim(line);
-    istringstream card(line);
-    
-    string winning_nums_str;
-    string my_nums_str;
-
-    getline(card, winning_nums_str, ':');
-    getline(card, winning_nums_str, '|');
-    getline(card, my_nums_str, '|');
-    
-    istringstream iss(winning_nums_str);
-    uint32_t num;
-    while (iss >> num) {
-        winning_nums.push_back(num);
-    }
-
-    iss.str(my_nums_str);
-    iss.clear();
-    while (iss >> num) {
-        my_nums.push_back(num);
-    }
-}
-
-template<typename T>
-bool contains(const vector<T> &vec, const T &val){
-    for (const T &el : vec){
-        if (el == val) return true;
-    }
-    return false;
+    file.close();
 }
 
-int part1(const input_t &in) {
+int part1(const std::string &filename) {
     int points = 0;
-    for (const string &line : in){
-        int matches = 0;
-        vector<uint32_t> winning_nums;
-        vector<uint32_t> my_nums;
-        get_card_nums(line, winning_nums, my_nums);
-        
-        for (const uint32_t num : my_nums) {
-            if (contains(winning_nums, num)) {
-                matches++;
-            }
-        }
-
+    for_each_card(filename, [&points](const Card &card) {
+        const int matches = card.matches();
         if (matches){
             points += 1 << (matches-1); //< 2^(matches-1)
         }
-    }
+    });
 
     return points;
 }
 
-int part2(const input_t &in) {
-    int points = 0;
-    const size_t ncards = in.size();
-    vector<uint32_t> copies(ncards, 1);
-
-    for (size_t i = 0; i < ncards; ++i) {
-        const string &line = in[i];
-        int matches = 0;
-        vector<uint32_t> winning_nums;
-        vector<uint32_t> my_nums;
-        get_card_nums(line, winning_nums, my_nums);
-        
-        for (const uint32_t num : my_nums) {
-            if (contains(winning_nums, num)) { matches++; }
-        }
+// Number of instances of each card, fed one card at a time. Copies won by a
+// card are recorded as a difference array: +n where they start and -n one
+// past their last card. Only the window reachable by a single card is kept,
+// in a ring buffer, so memory does not grow with the number of cards.
+class CopyCounter {
+public:
+    // A card matches at most every possible number
+    static constexpr size_t MAX_MATCHES = Card::MAX_NUMBER;
+    static constexpr size_t WINDOW = std::bit_ceil(MAX_MATCHES + 1);
+
+    // Adds the next card, returns how many instances of it there are
+    uint64_t push(int matches) {
+        running += delta[next % WINDOW];
+        delta[next % WINDOW] = 0;
+        const uint64_t instances = 1 + running;
+        delta[(next + 1) % WINDOW] += instances;
+        delta[(next + 1 + matches) % WINDOW] -= instances;
+        ++next;
+        sum += instances;
+        return instances;
+    }
+
+    uint64_t total() const { return sum; }
 
-        for (size_t j = i+1; j < i+1+matches && j < ncards; ++j) { copies[j] += copies[i]; }
-        
+private:
+    std::array<int64_t, WINDOW> delta{};
+    int64_t running = 0;
+    size_t next = 0;
+    uint64_t sum = 0;
+};
+
+
+uint64_t part2(const std::string &filename) {
+    CopyCounter counter;
+    for_each_card(filename, [&counter](const Card &card) {
+        [[maybe_unused]] const uint64_t instances = counter.push(card.matches());
         #ifdef _DEBUG
-        cout << "copies: ";
-        for (auto c : copies) cout << c << ",";
-        cout << endl;
+        cout << "instances: " << instances << endl;
         #endif
-    }
+    });
 
-    return accumulate(copies.begin(), copies.end(), 0);
+    return counter.total();
 }
 
 
@@ -132,9 +136,9 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    input_t lines = parse_inputs(argv[1]);
-    int res1 = part1(lines);
-    int res2 = part2(lines);
+    // Each part streams the cards from the file on its own
+    int res1 = part1(argv[1]);
+    uint64_t res2 = part2(argv[1]);
 
     std::cout << "-----PART 1-----\n";
     std::cout << "Points = " << res1 << std::endl;
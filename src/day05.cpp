@@ -6,6 +6,10 @@
 #include <cstdint>
 #include <numeric>
 #include <algorithm>
+#include <span>
+#include <bit>
+
+#include "recycles.h"
 
 
 using std::vector;
@@ -14,12 +18,17 @@ using std::istringstream;
 using std::cout;
 using std::endl;
 using std::getline;
+using utils::Interval;
+using utils::IntervalSet;
+using utils::Piece;
+using utils::PiecewiseMap;
 
 typedef std::vector<std::string> input_t;
 
 
 void usage(const std::string &program_name) {
-    std::cout << "Usage: " << program_name << " <input_file>\n";
+    std::cout << "Usage: " << program_name << " <input_file> [<location_lo> <location_hi>]\n";
+    std::cout << "  prints the seed ranges landing in [location_lo, location_hi) when given\n";
 }
 
 
@@ -61,16 +70,6 @@ struct Range {
     Range(uint64_t s, uint64_t c): start(s), count(c) {}
 
     uint64_t end() const { return start + count - 1; }
-    void set_start(uint64_t val) { start = val; }
-    void set_count(uint64_t val) { count = val; }
-    void set_end(uint64_t val) { 
-        if(val >= start) {
-            count = val - start + 1; 
-        } else {
-            printf("[WARNING] End value is smaller start of range\n");
-            exit(1);
-        }
-    }
 
     void print(const char *tail="\n") const {
         cout << "start: " << start << ", count: " << count << tail; 
@@ -79,54 +78,15 @@ struct Range {
     void print_start_end(const char *tail="\n") const {
         cout << "start: " << start << ", end: " << this->end() << tail; 
     }
-
-    bool is_overlap(const Range &other) const {
-        if (is_overlap_at_lower(other) || is_overlap_at_upper(other) || is_contained_in(other)) return true; 
-        return false;
-    }
-
-    //      [o o o]         < this
-    // [- - -o o o - - - -] < other
-    bool is_contained_in(const Range &other) const {
-        if (other.start <= start && end() <= other.end()) return true;
-        return false;
-    }
-
-    // [- - - - - - - o o o]         < this
-    //               [o o o - - - -] < other
-    bool is_overlap_at_upper(const Range &other) const {
-        if (start < other.start && other.end() > end() && other.start <= end()) return true; 
-        return false;
-    }
-
-    //               [o o o - - - -] < this
-    // [- - - - - - - o o o]         < other
-    bool is_overlap_at_lower(const Range &other) const {
-        if (start > other.start && other.end() < end() && start <= other.end()) return true; 
-        return false;
-    }
 };
 
-uint64_t map_num(uint64_t num, vector<Range> src_ranges, vector<Range> dst_ranges) {
-    for (size_t i = 0; i < src_ranges.size(); i++) {
-        uint64_t start = src_ranges[i].start;
-        uint64_t end = start + src_ranges[i].count;
-
-        if (num >= start && num < end) {
-            return dst_ranges[i].start + (num - start);
-        }
-    }
-    return num;
-}
-
-uint64_t part1(const input_t &in) {
-    vector<uint64_t> src = get_seeds(in[0]);
-    vector<uint64_t> dst(src.size(), 0);
+// Parses the seven "x-to-y map:" blocks following the seeds line
+vector<PiecewiseMap<uint64_t>> get_maps(const input_t &in) {
+    vector<PiecewiseMap<uint64_t>> ret;
 
     for (size_t i = 3; i < in.size(); i++){
-        vector<Range> src_ranges;
-        vector<Range> dst_ranges;
-        while(!in[i].empty()){
+        vector<Piece<uint64_t>> pieces;
+        while(i < in.size() && !in[i].empty()){
             istringstream iss(in[i]);
             uint64_t dst_start;
             uint64_t src_start;
@@ -135,29 +95,13 @@ uint64_t part1(const input_t &in) {
             iss >> src_start;
             iss >> count;
 
-            src_ranges.emplace_back(src_start, count);
-            dst_ranges.emplace_back(dst_start, count);
+            pieces.push_back({src_start, src_start + count, dst_start});
             i++;
-        } 
-
-        for (size_t j = 0; j < src.size(); j++) {
-            dst[j] = map_num(src[j], src_ranges, dst_ranges);
-            #ifdef _DEBUG
-            cout << src[j] << " => " << dst[j] << endl;
-            #endif
         }
-        src = dst;
+        ret.emplace_back(std::move(pieces));
         i++;
-        #ifdef _DEBUG
-        cout << endl;
-        #endif
     }
-
-    uint64_t min = UINT64_MAX;
-    for (uint64_t n : src){
-        if(min > n) min = n;
-    }
-    return min;
+    return ret;
 }
 
 vector<Range> get_seeds2(const string &line) {
@@ -174,96 +118,185 @@ vector<Range> get_seeds2(const string &line) {
     return ret;
 } 
 
-uint64_t part2(const input_t &in) {
-    vector<Range> src = get_seeds2(in[0]);
-    vector<Range> dst = src;
+// Read-only copy of a `PiecewiseMap` for large batches of lookups. The map
+// is flattened into segments covering the whole domain, each adding a
+// constant (mod 2^64) to its values. Segment starts are kept in Eytzinger
+// (BFS) order, padded to a full tree, so every search is the same number of
+// branchless steps and a batch of them can be interleaved while prefetching
+// the nodes a few levels down.
+class EytzingerMap {
+public:
+    EytzingerMap() : EytzingerMap(PiecewiseMap<uint64_t>()) {}
+
+    explicit EytzingerMap(const PiecewiseMap<uint64_t> &map) {
+        // Segment starts after 0, each with the offset of the segment before it
+        vector<uint64_t> starts;
+        vector<uint64_t> prev_offset;
+        uint64_t offset = 0;
+        uint64_t covered = 0;
+        for (const auto &p : map.pieces()) {
+            if (p.lo > covered) {
+                starts.push_back(covered);
+                prev_offset.push_back(offset);
+                offset = 0;
+            }
+            starts.push_back(p.lo);
+            prev_offset.push_back(offset);
+            offset = p.dst - p.lo;
+            covered = p.hi;
+        }
+        starts.push_back(covered);
+        prev_offset.push_back(offset);
+        offset = 0;
+        if (!starts.empty() && starts.front() == 0) {
+            starts.erase(starts.begin());
+            prev_offset.erase(prev_offset.begin());
+        }
 
-    for (size_t i = 3; i < in.size(); i++){
-        vector<Range> src_ranges;
-        vector<Range> dst_ranges;
-        while(!in[i].empty()){
-            istringstream iss(in[i]);
-            uint64_t dst_start;
-            uint64_t src_start;
-            uint64_t count;
-            iss >> dst_start;
-            iss >> src_start;
-            iss >> count;
+        // Past the last start (and in the padding) the last segment applies
+        height = std::bit_width(starts.size());
+        const size_t n = (size_t(1) << height) - 1;
+        starts.resize(n, std::numeric_limits<uint64_t>::max());
+        prev_offset.resize(n, offset);
+        keys.resize(n + 1);
+        offsets.resize(n + 1);
+        offsets[0] = offset;
+        size_t i = 0;
+        fill(starts, prev_offset, i, 1);
+    }
 
-            src_ranges.emplace_back(src_start, count);
-            dst_ranges.emplace_back(dst_start, count);
-            i++;
+    uint64_t operator()(uint64_t v) const {
+        size_t k = 1;
+        for (int level = 0; level < height; ++level) {
+            k = 2 * k + (keys[k] <= v);
         }
+        return v + offsets[k >> std::countr_one(k) >> 1];
+    }
 
-        #ifdef _DEBUG
-        std::cout << "================================================================\n";
-        std::cout << "map src_ranges -> dst_ranges \n";
-        for (size_t ii = 0; ii < src_ranges.size(); ii++) {
-            std::cout << ii << ") ";
-            src_ranges[ii].print_start_end("");
-            cout << " -> ";
-            dst_ranges[ii].print_start_end("\n");
-        }
-        #endif
-
-        for (size_t j = 0; j < dst.size(); j++) {
-            for (size_t k = 0; k < src_ranges.size(); k++) {
-                if (dst[j].is_contained_in(src_ranges[k])){
-                    //      [o o o]         < dst[j]
-                    // [- - -o o o - - - -] < src_ranges[k]
-                    dst[j].start = dst_ranges[k].start + (dst[j].start - src_ranges[k].start);
-                    break;
-                }
-                else if (dst[j].is_overlap_at_upper(src_ranges[k])) {
-                    Range nr(dst[j].start, 0);
-                    nr.set_end(src_ranges[k].start-1);
-                    dst.push_back(nr);
-                    // [- - - - - - - A A A] dst[j]
-                    //               [A A A - - - -] src_range
-                    int64_t e_old = dst[j].end();
-                    dst[j].start = dst_ranges[k].start;
-                    dst[j].set_end(dst_ranges[k].start + (e_old - src_ranges[k].start));
-                    break;
-                }
-                else if (dst[j].is_overlap_at_lower(src_ranges[k])) {
-                    Range nr(src_ranges[k].end() + 1, 0);
-                    nr.set_end(dst[j].end());
-                    dst.push_back(nr);
-                    //               [A A A - - - -] dst[j]
-                    // [- - - - - - - A A A] src_range
-                    int64_t s_old = dst[j].start;
-                    dst[j].start = dst_ranges[k].start + (src_ranges[k].end() - s_old);
-                    dst[j].set_end(dst_ranges[k].end());
-                    break;
+    // Maps every value of `in` into `out`, which must be at least as large
+    void operator()(std::span<const uint64_t> in, std::span<uint64_t> out) const {
+        size_t ks[BATCH];
+        size_t first = 0;
+        for (; first + BATCH <= in.size(); first += BATCH) {
+            for (size_t j = 0; j < BATCH; ++j) ks[j] = 1;
+            for (int level = 0; level < height; ++level) {
+                for (size_t j = 0; j < BATCH; ++j) {
+                    __builtin_prefetch(keys.data() + std::min(PREFETCH * ks[j], keys.size() - 1));
+                    ks[j] = 2 * ks[j] + (keys[ks[j]] <= in[first + j]);
                 }
             }
+            for (size_t j = 0; j < BATCH; ++j) {
+                out[first + j] = in[first + j] + offsets[ks[j] >> std::countr_one(ks[j]) >> 1];
+            }
         }
-        #ifdef _DEBUG 
-        {
-        // std::cout << "================================================================\n";
-        std::cout << "src = \n";
-        int ii=1;
-        for (auto el : src) {
-            std::cout << ii++ << ") ";
-            el.print_start_end();;
+        for (; first < in.size(); ++first) {
+            out[first] = (*this)(in[first]);
         }
-        std::cout << "dst = \n";
-        ii=1;
-        for (auto el : dst) {
-            std::cout << ii++ << ") ";
-            el.print_start_end();
-        }}
-        #endif
-
-        src = dst;
-        i++;
     }
 
-    uint64_t min = UINT64_MAX;
-    for (const Range &n : src){
-        if(min > n.start) min = n.start;
+    vector<uint64_t> operator()(std::span<const uint64_t> in) const {
+        vector<uint64_t> out(in.size());
+        (*this)(in, out);
+        return out;
+    }
+
+private:
+    // Searches interleaved by a batch lookup
+    static constexpr size_t BATCH = 16;
+    // Node whose cache line holds the descendants 3 levels down
+    static constexpr size_t PREFETCH = 8;
+
+    int height = 0;
+    vector<uint64_t> keys;      // 1-based Eytzinger order
+    vector<uint64_t> offsets;   // offsets[k]: segment before keys[k], [0] last segment
+
+    // In-order walk of the implicit tree, handing out the sorted starts
+    void fill(const vector<uint64_t> &starts, const vector<uint64_t> &prev_offset, size_t &i, size_t k) {
+        if (k >= keys.size()) return;
+        fill(starts, prev_offset, i, 2 * k);
+        keys[k] = starts[i];
+        offsets[k] = prev_offset[i];
+        ++i;
+        fill(starts, prev_offset, i, 2 * k + 1);
     }
-    return min;
+};
+
+// Seeds and the seed to location map, the stages of the almanac composed
+// into a single piecewise-linear map at load time.
+struct Almanac {
+    vector<uint64_t> seeds;
+    vector<Range> seed_ranges;
+    PiecewiseMap<uint64_t> seed_to_location;
+    EytzingerMap seed_to_location_batch;
+};
+
+Almanac get_almanac(const input_t &in) {
+    Almanac almanac;
+    almanac.seeds = get_seeds(in[0]);
+    almanac.seed_ranges = get_seeds2(in[0]);
+    for (const auto &map : get_maps(in)) {
+        almanac.seed_to_location = almanac.seed_to_location.compose(map);
+    }
+    almanac.seed_to_location_batch = EytzingerMap(almanac.seed_to_location);
+    #ifdef _DEBUG
+    for (const auto &p : almanac.seed_to_location.pieces()) {
+        cout << "[" << p.lo << ", " << p.hi << ") => " << p.dst << endl;
+    }
+    #endif
+    return almanac;
+}
+
+IntervalSet<uint64_t> to_set(const vector<Range> &ranges) {
+    vector<Interval<uint64_t>> intervals;
+    for (const Range &r : ranges) {
+        intervals.push_back({r.start, r.start + r.count});
+    }
+    return IntervalSet<uint64_t>(std::move(intervals));
+}
+
+// Seed sub-ranges whose location lies in [lo, hi)
+vector<Range> seeds_for_locations(const Almanac &almanac, uint64_t lo, uint64_t hi) {
+    const IntervalSet<uint64_t> seeds = almanac.seed_to_location
+        .preimage(IntervalSet<uint64_t>(lo, hi))
+        .intersect(to_set(almanac.seed_ranges));
+    vector<Range> ret;
+    for (const auto &iv : seeds) {
+        ret.emplace_back(iv.lo, iv.size());
+    }
+    return ret;
+}
+
+// Lowest location of any seed range, walking locations upward in doubling
+// windows until one of them is reached from a seed.
+uint64_t lowest_location_reverse(const Almanac &almanac) {
+    const IntervalSet<uint64_t> seeds = to_set(almanac.seed_ranges);
+    const uint64_t end = std::numeric_limits<uint64_t>::max();
+    for (uint64_t lo = 0, width = 1; lo < end; lo += width, width *= 2) {
+        const uint64_t hi = end - lo > width ? lo + width : end;
+        const IntervalSet<uint64_t> hits = almanac.seed_to_location
+            .preimage(IntervalSet<uint64_t>(lo, hi))
+            .intersect(seeds);
+        if (!hits.empty()) return almanac.seed_to_location.image(hits).min();
+        if (hi == end) break;
+    }
+    return end;
+}
+
+uint64_t part1(const Almanac &almanac) {
+    const vector<uint64_t> locations = almanac.seed_to_location_batch(almanac.seeds);
+    #ifdef _DEBUG
+    for (size_t i = 0; i < locations.size(); ++i) {
+        cout << almanac.seeds[i] << " => " << locations[i] << endl;
+    }
+    #endif
+    return *std::min_element(locations.begin(), locations.end());
+}
+
+uint64_t part2(const Almanac &almanac) {
+    #ifdef _DEBUG
+    cout << "Lowest location walking backwards: " << lowest_location_reverse(almanac) << endl;
+    #endif
+    return almanac.seed_to_location.image(to_set(almanac.seed_ranges)).min();
 }
 
 
@@ -274,13 +307,23 @@ int main(int argc, char *argv[]) {
     }
 
     input_t lines = parse_inputs(argv[1]);
-    uint64_t res1 = part1(lines);
-    uint64_t res2 = part2(lines);
+    const Almanac almanac = get_almanac(lines);
+    uint64_t res1 = part1(almanac);
+    uint64_t res2 = part2(almanac);
 
     std::cout << "-----PART 1-----\n";
     std::cout << "Lowest Location = " << res1 << std::endl;
     std::cout << "-----PART 2-----\n";
     std::cout << "Lowest Location = " << res2 << std::endl;
 
+    if (argc > 3) {
+        const uint64_t lo = std::stoull(argv[2]);
+        const uint64_t hi = std::stoull(argv[3]);
+        std::cout << "-----SEEDS-----\n";
+        for (const Range &r : seeds_for_locations(almanac, lo, hi)) {
+            r.print_start_end();
+        }
+    }
+
     return 0;
 }
\ No newline at end of file
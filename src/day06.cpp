@@ -4,12 +4,23 @@
 #include <vector>
 #include <string>
 #include <numeric>
-#include <math.h>
 #include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <span>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "recycles.h"
 
 
 typedef std::vector<std::string> input_t;
 
+using utils::u128;
+
 
 void usage(const std::string &program_name) {
     std::cout << "Usage: " << program_name << " <input_file>\n";
@@ -34,91 +45,258 @@ input_t parse_inputs(const std::string &filename) {
     return lines;
 }
 
-inline double dist(double t, double record) {
-    return (record - t) * t;
+struct Race {
+    u128 time;
+    u128 record;
+};
+
+
+std::string to_string(u128 v) {
+    std::string s;
+    do {
+        s.push_back('0' + (char)(v % 10));
+        v /= 10;
+    } while (v);
+    return std::string(s.rbegin(), s.rend());
 }
 
-int part1(const input_t &in) {
-    std::vector<std::pair<double, double>> time_dist;
 
-    double t, x;
-    std::string without_label = in[0].substr(6); //< Remove "Time:"
-    std::istringstream iss_time(without_label);
-    without_label = in[1].substr(10); //< Remove "Distance:"
-    std::istringstream iss_dist(without_label);
-    while (iss_time >> t && iss_dist >> x) {
-        time_dist.emplace_back(t, x);
+// Numbers after the label of a line, or a single number made of all its
+// digits when `joined` (part 2 kerning)
+std::vector<u128> get_numbers(const std::string &line, bool joined) {
+    constexpr u128 MAX = ~u128(0);
+    std::vector<u128> nums;
+    bool in_number = false;
+    for (size_t i = line.find(':') + 1; i < line.size(); ++i) {
+        const char c = line[i];
+        if (c >= '0' && c <= '9') {
+            if (!in_number) nums.push_back(0);
+            const unsigned digit = c - '0';
+            if (nums.back() > (MAX - digit) / 10) {
+                std::cerr << "Number does not fit in 128 bits: \"" << line << "\"" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            nums.back() = nums.back() * 10 + digit;
+            in_number = true;
+        } else if (!joined) {
+            in_number = false;
+        }
     }
+    return nums;
+}
 
-    int prod = 1;
-    for (auto &t_x : time_dist){
-        // Some high school level math...
-        double _max_dist = t_x.first * t_x.first * 0.25; // Not needed but I did the math anyways
-        double best_time = t_x.first * 0.5;
-        
-        int sum = 0;
-        // Forward loop
-        int t = static_cast<int>(std::round(best_time));
-        while (dist(t, t_x.first) > t_x.second) {
-            t++;
-            sum++;
-        }
+std::vector<Race> get_races(const input_t &in, bool joined) {
+    const std::vector<u128> times = get_numbers(in[0], joined);
+    const std::vector<u128> records = get_numbers(in[1], joined);
+    std::vector<Race> races;
+    for (size_t i = 0; i < times.size() && i < records.size(); ++i) {
+        races.push_back({times[i], records[i]});
+    }
+    return races;
+}
 
-        // The function is symmetric (quadratic) so the solution is however
-        // if the optimal time is int we need to subtract one because we count
-        // the peak twice
-        sum *= 2;
-        double tmp;
-        if (std::modf(best_time, &tmp) == 0) {
-            sum--;
-        }
 
-        prod *= sum;
-        #ifdef _DEBUG 
-        std::cout << sum << std::endl;
-        #endif
+// Just enough 256-bit arithmetic for T^2 - 4D with 128-bit T and D
+struct U256 {
+    u128 hi;
+    u128 lo;
+
+    bool operator==(const U256 &rhs) const = default;
+
+    bool operator<(const U256 &rhs) const {
+        return hi != rhs.hi ? hi < rhs.hi : lo < rhs.lo;
+    }
+
+    U256 operator+(const U256 &rhs) const {
+        const u128 l = lo + rhs.lo;
+        return {hi + rhs.hi + (l < lo), l};
     }
 
-    return prod;
+    U256 operator-(const U256 &rhs) const {
+        return {hi - rhs.hi - (lo < rhs.lo), lo - rhs.lo};
+    }
+
+    // 0 < k < 128
+    U256 operator>>(int k) const {
+        return {hi >> k, lo >> k | hi << (128 - k)};
+    }
+};
+
+U256 mul_wide(u128 a, u128 b) {
+    const u128 a0 = (uint64_t)a, a1 = a >> 64;
+    const u128 b0 = (uint64_t)b, b1 = b >> 64;
+    const u128 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    const u128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;
+    return {p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64), mid << 64 | (uint64_t)p00};
 }
 
 
+// floor(sqrt(n)), exact, from any positive estimate. One Newton step from
+// anywhere lands at or above the root, then integer steps correct it. With a
+// double precision estimate that is a single division and a few compares.
+u128 isqrt(u128 n, u128 estimate) {
+    u128 x = std::clamp<u128>(estimate, 1, UINT64_MAX);
+    x = std::min<u128>((x + n / x) / 2, UINT64_MAX);
+    while (x * x > n) x = (x + n / x) / 2;
+    while (x < UINT64_MAX && (x + 1) * (x + 1) <= n) x++;
+    return x;
+}
 
-int part2(const input_t &in) {
-    double time_race;
-    double record_dist;
-    // Parse strings
-    std::string time_str = in[0].substr(6); //< Remove "Time:"
-    time_str.erase(std::remove_if(time_str.begin(), time_str.end(), ::isspace), time_str.end());
-    std::istringstream iss_time(time_str);
-    iss_time >> time_race;
+u128 isqrt(u128 n) {
+    return isqrt(n, (u128)std::sqrt((long double)n));
+}
 
-    std::string dist_str = in[1].substr(10); //< Remove "Distance:"
-    dist_str.erase(std::remove_if(dist_str.begin(), dist_str.end(), ::isspace), dist_str.end());
-    std::istringstream iss_dist(dist_str);
-    iss_dist >> record_dist;
+// floor(sqrt(n)) of a 256-bit number, one result bit per step
+u128 isqrt(U256 n) {
+    if (n.hi == 0) return isqrt(n.lo);
 
-    // Some high school level math...
-    double _max_dist = time_race * time_race * 0.25; // Not needed but I did the math anyways
-    double best_time = time_race * 0.5;
-    
-    int sum = 0;
-    // Forward loop
-    int t = static_cast<int>(std::round(best_time));
-    while (dist(t, time_race) > record_dist) {
-        t++;
-        sum++;
+    // Highest power of 4 not above n
+    const uint64_t hi64 = n.hi >> 64;
+    const int width = hi64 ? 192 + std::bit_width(hi64) : 128 + std::bit_width((uint64_t)n.hi);
+    const int top = (width - 1) & ~1;
+    U256 bit = {u128(1) << (top - 128), 0};
+    U256 root = {0, 0};
+    while (!(bit == U256{0, 0})) {
+        const U256 t = root + bit;
+        if (!(n < t)) {
+            n = n - t;
+            root = (root >> 1) + bit;
+        } else {
+            root = root >> 1;
+        }
+        bit = bit >> 2;
     }
+    return root.lo;
+}
+
+
+// Holding the button for h ms wins when h * (T - h) > D, that is
+// (2h - T)^2 < T^2 - 4D. With x = 2h - T the winning x are the ones with the
+// parity of T in [-s, s], s = isqrt(T^2 - 4D - 1). T^2 is computed in 256
+// bits, so any 128-bit time and record is exact; the square root is O(1)
+// through the 128-bit path whenever T^2 - 4D fits in it (times below 2^64).
+
+// T^2 - 4D - 1 into `disc`, false when the race can't be won
+inline bool discriminant(u128 time, u128 record, U256 &disc) {
+    const U256 t2 = mul_wide(time, time);
+    const U256 four_d_1 = {record >> 126, record << 2 | 1};
+    if (t2 < four_d_1) return false;    // 4D >= T^2
+    disc = t2 - four_d_1;
+    return true;
+}
+
+inline u128 ways_from_root(u128 time, u128 s) {
+    return s + ((s & 1) == (time & 1));
+}
 
-    // The function is symmetric (quadratic) so the solution is however
-    // if the optimal time is int we need to subtract one because we count
-    // the peak twice
-    sum *= 2;
-    double tmp;
-    if (std::modf(best_time, &tmp) == 0) {
-        sum--;
+u128 ways_to_win(const Race &race) {
+    U256 disc;
+    if (!discriminant(race.time, race.record, disc)) return 0;
+    return ways_from_root(race.time, isqrt(disc));
+}
+
+
+// Races stored column-wise for batches of millions
+struct RaceColumns {
+    std::vector<u128> time;
+    std::vector<u128> record;
+
+    size_t size() const { return time.size(); }
+
+    void push_back(const Race &race) {
+        time.push_back(race.time);
+        record.push_back(race.record);
+    }
+};
+
+
+// Races evaluated together: discriminants in integers, square roots for the
+// whole block in double precision, then the exact integer correction.
+constexpr size_t BLOCK = 256;
+
+// Minimum number of races given to a worker thread
+constexpr size_t MIN_CHUNK = 1 << 16;
+
+
+// Square roots of `in[0..n)` into `out`
+void sqrt_block(const double *in, double *out, size_t n) {
+    size_t i = 0;
+    #if defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(_mm_loadu_pd(in + i)));
+    }
+    #endif
+    for (; i < n; ++i) {
+        out[i] = std::sqrt(in[i]);
+    }
+}
+
+
+// Ways to win each race (time[i], record[i]) into out[i]. Discriminants too
+// wide for a double estimate take the exact 256-bit square root.
+void ways_to_win(std::span<const u128> time, std::span<const u128> record, std::span<u128> out) {
+    U256 disc[BLOCK];
+    bool wins[BLOCK];
+    double approx[BLOCK];
+    double root[BLOCK];
+    for (size_t first = 0; first < time.size(); first += BLOCK) {
+        const size_t n = std::min(BLOCK, time.size() - first);
+        for (size_t i = 0; i < n; ++i) {
+            disc[i] = {0, 0};
+            wins[i] = discriminant(time[first + i], record[first + i], disc[i]);
+            approx[i] = (double)disc[i].lo;
+        }
+        sqrt_block(approx, root, n);
+        for (size_t i = 0; i < n; ++i) {
+            const u128 s = disc[i].hi ? isqrt(disc[i]) : isqrt(disc[i].lo, (u128)root[i]);
+            out[first + i] = wins[i] * ways_from_root(time[first + i], s);
+        }
+    }
+}
+
+
+// Folds the ways to win of every race with `op`, `identity` being its neutral
+// element (e.g. 0 and + for a sum, 1 and * for a product, both mod 2^128).
+// Large batches are split into one chunk per hardware thread.
+template<typename Op>
+u128 reduce_ways(const RaceColumns &races, u128 identity, Op op) {
+    auto reduce_chunk = [&](size_t first, size_t last) {
+        u128 ways[BLOCK];
+        u128 acc = identity;
+        for (; first < last; first += BLOCK) {
+            const size_t n = std::min(BLOCK, last - first);
+            ways_to_win(std::span(races.time).subspan(first, n),
+                        std::span(races.record).subspan(first, n),
+                        std::span(ways, n));
+            for (size_t i = 0; i < n; ++i) acc = op(acc, ways[i]);
+        }
+        return acc;
+    };
+
+    const size_t workers = utils::workerCount(races.size(), MIN_CHUNK);
+    std::vector<u128> partial(workers);
+    utils::forEachChunk(races.size(), workers, [&](size_t w, size_t first, size_t last) {
+        partial[w] = reduce_chunk(first, last);
+    });
+    return std::accumulate(partial.begin(), partial.end(), identity, op);
+}
+
+
+u128 part1(const input_t &in) {
+    RaceColumns races;
+    for (const Race &race : get_races(in, false)) {
+        races.push_back(race);
+        #ifdef _DEBUG 
+        std::cout << to_string(ways_to_win(race)) << std::endl;
+        #endif
     }
-    return sum;
+
+    return reduce_ways(races, 1, std::multiplies<u128>());
+}
+
+
+u128 part2(const input_t &in) {
+    return ways_to_win(get_races(in, true).front());
 }
 
 
@@ -129,14 +307,14 @@ int main(int argc, char *argv[]) {
     }
 
     input_t lines = parse_inputs(argv[1]);
-    int res1 = part1(lines);
-    int res2 = part2(lines);
+    u128 res1 = part1(lines);
+    u128 res2 = part2(lines);
 
 
     std::cout << "-----PART 1-----\n";
-    std::cout << "sol = " << res1 << std::endl;
+    std::cout << "sol = " << to_string(res1) << std::endl;
     std::cout << "-----PART 2-----\n";
-    std::cout << "sol = " << res2 << std::endl;
+    std::cout << "sol = " << to_string(res2) << std::endl;
 
     return 0;
 }
\ No newline at end of file
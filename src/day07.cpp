@@ -6,7 +6,9 @@
 #include <numeric>
 #include <cstdint>
 #include <algorithm>
-#include <unordered_map>
+#include <array>
+
+#include "recycles.h"
 
 
 typedef std::vector<std::string> input_t;
@@ -44,59 +46,102 @@ enum class HandType {
     FiveOfAKind = 7,
 };
 
-std::pair<char,uint32_t> getMostFreqCard(const std::unordered_map<char, uint32_t> &handmap) {
-    return *std::max_element(handmap.begin(), handmap.end(),
-        [] (
-            const std::pair<char, int>& a,
-            const std::pair<char, int>& b) -> 
-            bool{ return a.second < b.second; }
-    );
-}
+// Hand types are tabulated at compile time by the shape of the hand: how
+// many distinct ranks it holds and how many cards the largest group has.
+// Jokers join the largest group of the other cards, which is always the best
+// use of them.
+constexpr size_t SHAPES = 6;
+
+// Types are told apart by the number of pairs of equal cards in the hand
+constexpr std::array<HandType, 11> TYPE_BY_PAIRS = {
+    HandType::HighCard,         // 0
+    HandType::OnePair,          // 1
+    HandType::TwoPair,          // 2
+    HandType::ThreeOfAKind,     // 3
+    HandType::FullHouse,        // 4
+    HandType::HighCard,         // unused
+    HandType::FourOfAKind,      // 6
+    HandType::HighCard,         // unused
+    HandType::HighCard,         // unused
+    HandType::HighCard,         // unused
+    HandType::FiveOfAKind,      // 10
+};
 
-HandType getHandType(const std::string &hand) {
-    std::unordered_map<char, uint32_t> hand_map{};
+constexpr uint32_t pairsOf(uint32_t n) {
+    return n * (n - 1) / 2;
+}
 
-    for (char c : hand) {
-        if(hand_map.contains(c)) {
-           hand_map[c]++; 
-        } else {
-            hand_map[c] = 1;
-        }
+// Splits the `left` non-joker cards in groups of at most `largest` cards,
+// largest first, and sets the type of every resulting shape. `pairs` counts
+// the pairs within the groups so far, `top` is the first group.
+constexpr void fillShapes(std::array<HandType, SHAPES * SHAPES * SHAPES> &table, uint32_t jokers,
+                          uint32_t left, uint32_t largest, uint32_t distinct, uint32_t top, uint32_t pairs) {
+    if (left == 0) {
+        table[(jokers * SHAPES + distinct) * SHAPES + top] =
+            TYPE_BY_PAIRS[pairs - pairsOf(top) + pairsOf(top + jokers)];
+        return;
+    }
+    for (uint32_t group = std::min(left, largest); group > 0; --group) {
+        fillShapes(table, jokers, left - group, group, distinct + 1, top ? top : group, pairs + pairsOf(group));
     }
+}
 
-    switch (hand_map.size()) {
-    case 1:
-        return HandType::FiveOfAKind;
-    case 2:
-        if (getMostFreqCard(hand_map).second == 4) {
-            return HandType::FourOfAKind;
-        }
-        
-        return HandType::FullHouse;
-    case 3:
-        if (getMostFreqCard(hand_map).second == 3) {
-            return HandType::ThreeOfAKind;
+// [jokers][distinct][top], distinct and top not counting the jokers
+constexpr std::array<HandType, SHAPES * SHAPES * SHAPES> JOKER_HAND_TYPES = [] {
+    std::array<HandType, SHAPES * SHAPES * SHAPES> table{};
+    table.fill(HandType::HighCard);
+    for (uint32_t jokers = 0; jokers < SHAPES; ++jokers) {
+        fillShapes(table, jokers, 5 - jokers, 5, 0, 0, 0);
+    }
+    return table;
+}();
+
+// [distinct][top], the shapes without jokers
+constexpr std::array<HandType, SHAPES * SHAPES> HAND_TYPES = [] {
+    std::array<HandType, SHAPES * SHAPES> table{};
+    std::copy_n(JOKER_HAND_TYPES.begin(), table.size(), table.begin());
+    return table;
+}();
+
+static_assert(HAND_TYPES[2 * SHAPES + 3] == HandType::FullHouse);                          // 33322
+static_assert(HAND_TYPES[3 * SHAPES + 2] == HandType::TwoPair);                            // KK677
+static_assert(JOKER_HAND_TYPES[(2 * SHAPES + 2) * SHAPES + 2] == HandType::FourOfAKind);   // KTJJT
+static_assert(JOKER_HAND_TYPES[(5 * SHAPES + 0) * SHAPES + 0] == HandType::FiveOfAKind);   // JJJJJ
+
+
+// Distinct ranks and largest group among the cards of a packed hand (see
+// packCards), ignoring rank `skip`. Returns the number of `skip` cards.
+inline uint32_t handShape(uint32_t cards, uint32_t skip, uint32_t &distinct, uint32_t &top) {
+    uint8_t count[16] = {};
+    uint32_t skipped = 0;
+    distinct = 0;
+    top = 0;
+    for (size_t i = 0; i < 5; ++i, cards >>= 4) {
+        const uint32_t rank = cards & 0xF;
+        if (rank == skip) {
+            skipped++;
+            continue;
         }
-        
-        return HandType::TwoPair;
-    case 4:
-        return HandType::OnePair;
-    case 5:
-        return HandType::HighCard;
-    default:
-        std::cout << "Unreachable!" << std::endl;
-        exit(1);
-        break;
+        distinct += ++count[rank] == 1;
+        top = std::max<uint32_t>(top, count[rank]);
     }
+    return skipped;
 }
 
+HandType getHandType(uint32_t cards) {
+    uint32_t distinct;
+    uint32_t top;
+    handShape(cards, 0x10, distinct, top);
+    return HAND_TYPES[distinct * SHAPES + top];
+}
 
-struct Hand {
-    std::string hand;
-    HandType type;
-    int bet;
-    std::string cardsorder;
-};
+// Jokers are rank 0 under the part 2 card order
+HandType getHandType2(uint32_t cards) {
+    uint32_t distinct;
+    uint32_t top;
+    const uint32_t jokers = handShape(cards, 0, distinct, top);
+    return JOKER_HAND_TYPES[(jokers * SHAPES + distinct) * SHAPES + top];
+}
 
 
 std::string getHandTypeName(HandType hand) {
@@ -122,150 +167,134 @@ std::string getHandTypeName(HandType hand) {
     }
 }
 
-bool operator<(Hand a, Hand b) {
-    if (a.type != b.type) {
-        return a.type < b.type;
-    }
-    
-    const std::string &order = a.cardsorder;
+// A hand packed into a sort key: 4 bits of type then the 4-bit rank of each
+// card, first card most significant. Keys compare like hands.
+constexpr uint32_t KEY_BITS = 4 + 5 * 4;
+
+struct Bid {
+    uint32_t key;
+    uint32_t bet;
+};
+
+
+// The five card ranks, 4 bits each
+uint32_t packCards(const std::string &hand, const std::array<uint8_t, 256> &ranks) {
+    uint32_t cards = 0;
     for (size_t i = 0; i < 5; ++i) {
-        if (a.hand[i] == b.hand[i]) continue;
-        const char ac = a.hand[i]; 
-        const char bc = b.hand[i]; 
-        return order.find(ac) < order.find(bc);
+        cards = cards << 4 | ranks[static_cast<uint8_t>(hand[i])];
     }
-
-    // Unreachable
-    std::cout << "Unreachable in less than reached!\n";
-    return true;
+    return cards;
 }
 
-int part1(const input_t &in) {
-    const std::string CARDS_ORDER = "23456789TJQKA";
-    std::vector<Hand> hands{};
-    #ifdef _DEBUG
-    std::cout << "Unsorted:\n";
-    #endif
-    for (const std::string &line : in) {
-        std::istringstream iss(line);
-        std::string hand;
-        int bet;
-        std::getline(iss, hand, ' ');
-        iss >> bet;
-        HandType type = getHandType(hand);
-        
-        #ifdef _DEBUG
-        std::cout << "Hand: " <<  hand << ", Bet: " << bet << ", Type: " << getHandTypeName(type) << "\n";
-        #endif
-        hands.emplace_back(std::move(hand), type, bet, CARDS_ORDER);
-    }
 
-    // Money printing part
-    int winnings = 0;
-    std::sort(hands.begin(), hands.end());
-    #ifdef _DEBUG
-    std::cout << "\nSorted:\n";
-    #endif
-    for (size_t i = 0; i < hands.size(); i++) {
-        const Hand &h = hands[i];
-        winnings += h.bet * (i + 1);
-        #ifdef _DEBUG
-        std::cout << "Hand: " <<  h.hand << ", Bet: " << h.bet << ", Type: " << getHandTypeName(h.type) << "\n";
-        #endif
+std::string unpackHand(uint32_t key, const std::string &order) {
+    std::string hand(5, ' ');
+    for (size_t i = 5; i-- > 0; key >>= 4) {
+        hand[i] = order[key & 0xF];
     }
+    return hand;
+}
+
 
-    return winnings;
+HandType keyType(uint32_t key) {
+    return static_cast<HandType>(key >> 20);
 }
 
-HandType getHandType2(const std::string &hand) {
-    std::unordered_map<char, uint32_t> hand_map{};
 
-    for (char c : hand) {
-        if(hand_map.contains(c)) {
-           hand_map[c]++; 
-        } else {
-            hand_map[c] = 1;
+// Minimum number of bids given to a worker thread
+constexpr size_t MIN_CHUNK = 1 << 16;
+
+
+// LSD radix sort on the key, 8 bits per pass. Stable, so equal hands keep
+// their input order. Every pass splits the bids in one chunk per worker:
+// each worker counts the digits of its chunk, the counts are laid out digit
+// by digit and worker by worker, then each worker scatters its chunk to its
+// own slots.
+void radixSort(std::vector<Bid> &bids) {
+    const size_t workers = utils::workerCount(bids.size(), MIN_CHUNK);
+    std::vector<Bid> tmp(bids.size());
+    std::vector<std::array<size_t, 256>> start(workers);
+    for (uint32_t shift = 0; shift < KEY_BITS; shift += 8) {
+        utils::forEachChunk(bids.size(), workers, [&](size_t w, size_t first, size_t last) {
+            start[w].fill(0);
+            for (size_t i = first; i < last; ++i) start[w][(bids[i].key >> shift) & 0xFF]++;
+        });
+
+        size_t offset = 0;
+        for (size_t d = 0; d < 256; ++d) {
+            for (size_t w = 0; w < workers; ++w) {
+                const size_t count = start[w][d];
+                start[w][d] = offset;
+                offset += count;
+            }
         }
+
+        utils::forEachChunk(bids.size(), workers, [&](size_t w, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) tmp[start[w][(bids[i].key >> shift) & 0xFF]++] = bids[i];
+        });
+        bids.swap(tmp);
     }
+}
 
-    switch (hand_map.size()) {
-    case 1:
-        return HandType::FiveOfAKind;
-    case 2:
-        if (getMostFreqCard(hand_map).second == 4) {
-            if (hand_map.contains('J'))
-                return HandType::FiveOfAKind;
-            return HandType::FourOfAKind;
-        }
 
-        if (hand_map.contains('J'))
-            return HandType::FiveOfAKind;
-        return HandType::FullHouse;
-    case 3:
-        if (getMostFreqCard(hand_map).second == 3) {
-            if (hand_map.contains('J'))
-                return HandType::FourOfAKind;
-            return HandType::ThreeOfAKind;
-        }
-        
-        if (hand_map.contains('J')) { 
-            if (hand_map['J'] == 1)
-                return HandType::FullHouse;
-            if (hand_map['J'] == 2)
-                return HandType::FourOfAKind ;
-        }
-        return HandType::TwoPair;
-    case 4:
-        if (hand_map.contains('J')) 
-            return HandType::ThreeOfAKind;
-
-        return HandType::OnePair;
-    case 5:
-        if (hand_map.contains('J'))
-            return HandType::OnePair;
-        return HandType::HighCard;
-    default:
-        std::cout << "Unreachable!" << std::endl;
-        exit(1);
-        break;
-    }
+// Sum of bet * rank over sorted bids, ranks starting at 1. Each worker knows
+// the rank of its first bid from its position, so chunks are independent.
+uint64_t weightedSum(const std::vector<Bid> &bids) {
+    const size_t workers = utils::workerCount(bids.size(), MIN_CHUNK);
+    std::vector<uint64_t> partial(workers, 0);
+    utils::forEachChunk(bids.size(), workers, [&](size_t w, size_t first, size_t last) {
+        uint64_t sum = 0;
+        for (size_t i = first; i < last; ++i) sum += uint64_t(bids[i].bet) * (i + 1);
+        partial[w] = sum;
+    });
+    return std::accumulate(partial.begin(), partial.end(), uint64_t(0));
 }
 
-int part2(const input_t &in) {
-    const std::string CARDS_ORDER = "J23456789TQKA";
-    std::vector<Hand> hands{};
+
+// Bets of all hands, ranked under the card `order` and the type rules of
+// `classify`, times their rank
+uint64_t totalWinnings(const input_t &in, const std::string &order, HandType (*classify)(uint32_t)) {
+    std::array<uint8_t, 256> ranks{};
+    for (size_t i = 0; i < order.size(); ++i) {
+        ranks[static_cast<uint8_t>(order[i])] = i;
+    }
+
+    std::vector<Bid> bids{};
+    bids.reserve(in.size());
     #ifdef _DEBUG
     std::cout << "Unsorted:\n";
     #endif
     for (const std::string &line : in) {
-        std::istringstream iss(line);
-        std::string hand;
-        int bet;
-        std::getline(iss, hand, ' ');
-        iss >> bet;
-        HandType type = getHandType2(hand);
-        
+        if (line.size() < 7) continue;
+        const std::string hand = line.substr(0, 5);
+        const uint32_t bet = std::stoul(line.substr(6));
+        const uint32_t cards = packCards(hand, ranks);
+        const HandType type = classify(cards);
+
         #ifdef _DEBUG
         std::cout << "Hand: " <<  hand << ", Bet: " << bet << ", Type: " << getHandTypeName(type) << "\n";
         #endif
-        hands.emplace_back(std::move(hand), type, bet, CARDS_ORDER);
+        bids.push_back({static_cast<uint32_t>(type) << 20 | cards, bet});
     }
 
     // Money printing part
-    int winnings = 0;
-    std::sort(hands.begin(), hands.end());
+    radixSort(bids);
     #ifdef _DEBUG
     std::cout << "\nSorted:\n";
-    #endif
-    for (size_t i = 0; i < hands.size(); i++) {
-        const Hand &h = hands[i];
-        winnings += h.bet * (i + 1);
-        #ifdef _DEBUG
-        std::cout << "Hand: " <<  h.hand << ", Bet: " << h.bet << ", Type: " << getHandTypeName(h.type) << "\n";
-        #endif
+    for (const Bid &b : bids) {
+        std::cout << "Hand: " <<  unpackHand(b.key, order) << ", Bet: " << b.bet << ", Type: " << getHandTypeName(keyType(b.key)) << "\n";
     }
+    #endif
+
+    return weightedSum(bids);
+}
+
+uint64_t part1(const input_t &in) {
+    return totalWinnings(in, "23456789TJQKA", getHandType);
+}
 
-    return winnings;
+uint64_t part2(const input_t &in) {
+    return totalWinnings(in, "J23456789TQKA", getHandType2);
 }
 
 
@@ -277,8 +306,8 @@ int main(int argc, char *argv[]) {
 
     input_t lines = parse_inputs(argv[1]);
     // Apparently we are printing money in this challenge. Just how I like it.
-    int res1 = part1(lines);
-    int res2 = part2(lines);
+    uint64_t res1 = part1(lines);
+    uint64_t res2 = part2(lines);
 
     std::cout << "-----PART 1-----\n";
     std::cout << "Total winnings = " << res1 << std::endl;
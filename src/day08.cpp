@@ -7,8 +7,10 @@
 #include <format>
 #include <numeric>
 #include <algorithm>
-#include <unordered_map>
 #include <filesystem>
+#include <bitset>
+
+#include "recycles.h"
 
 
 typedef std::vector<std::string> input_t;
@@ -37,98 +39,116 @@ input_t parse_inputs(const std::string &filename) {
     return lines;
 }
 
-std::string trim(const std::string& s) {
-    const int l = (int)s.length();
-    int a=0, b=l-1;
-    char c;
-    while(a<l && ((c=s[a])==' '||c=='\t'||c=='\n'||c=='\v'||c=='\f'||c=='\r'||c=='\0')) a++;
-    while(b>a && ((c=s[b])==' '||c=='\t'||c=='\n'||c=='\v'||c=='\f'||c=='\r'||c=='\0')) b--;
-    return s.substr(a, 1+b-a);
+// Node names are three characters out of [0-9A-Z] (the puzzle only uses
+// letters, the examples digits too) read as a base-36 number, so every
+// possible node has a dense 16-bit id and the network is two flat arrays.
+constexpr uint32_t NAME_BASE = 36;
+constexpr uint32_t NODE_IDS = NAME_BASE * NAME_BASE * NAME_BASE;
+
+inline uint32_t nameDigit(char c) {
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('A' <= c && c <= 'Z') return c - 'A' + 10;
+    std::cout << "Invalid node name character: \"" << c << "\"" << std::endl;
+    exit(1);
 }
 
-struct Node {
-    std::string name;
-    Node *left = nullptr;
-    Node *right = nullptr;
-};
+constexpr char NAME_DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
+inline uint16_t encodeName(const char *name) {
+    return (nameDigit(name[0]) * NAME_BASE + nameDigit(name[1])) * NAME_BASE + nameDigit(name[2]);
+}
 
-std::unordered_map<std::string, Node> createNodeMap(const input_t &lines) {
-    std::unordered_map<std::string, Node> nodes;
-    
-    for (const std::string &line : lines) {
-        std::istringstream iss(line);
-        std::string node_name;
-        std::string lnode;
-        std::string rnode;
-
-        std::getline(iss, node_name, '=');
-        node_name = trim(node_name);
-
-        std::getline(iss, lnode, '=');
-        lnode = trim(lnode);
-        lnode = lnode.substr(1, lnode.size()-2);
-        iss.str(lnode);
-        iss.clear();
-        std::getline(iss, lnode, ',');
-        std::getline(iss, rnode, ',');
-        rnode = trim(rnode);
-        
-        if (!nodes.contains(lnode)) nodes[lnode] = Node{lnode};
-        if (!nodes.contains(rnode)) nodes[rnode] = Node{rnode};
-        if (!nodes.contains(node_name)) {
-            nodes[node_name] = Node{node_name, &nodes[lnode], &nodes[rnode]};
-        } else {
-            nodes[node_name].left  = &nodes[lnode];
-            nodes[node_name].right = &nodes[rnode];
-        }
-    }
-    return nodes;
+std::string decodeName(uint16_t id) {
+    return {NAME_DIGITS[id / (NAME_BASE * NAME_BASE)], NAME_DIGITS[id / NAME_BASE % NAME_BASE], NAME_DIGITS[id % NAME_BASE]};
 }
 
+inline bool endsWith(uint16_t id, char c) {
+    return id % NAME_BASE == nameDigit(c);
+}
 
-int part1(const input_t &in) {
-    std::string instructions = in[0];
-    size_t len = instructions.size();
 
-    std::unordered_map<std::string, Node> nodes = createNodeMap(std::vector(in.begin()+2, in.end()));
-    #ifdef _DEBUG
-    for (auto &kv : nodes) {
-        std::cout << std::format("Node \"{}\", Left: {}, Right {}\n", kv.first, kv.second.left->name, kv.second.right->name);
+// next[0] is the left node of every id and next[1] the right one
+struct Network {
+    std::vector<uint16_t> next[2];
+    std::vector<uint16_t> nodes;        // ids present in the input
+    std::bitset<NODE_IDS> exists;       // same, as a set
+    std::bitset<NODE_IDS> is_end;       // name ends with 'Z'
+};
+
+
+// Lines look like "AAA = (BBB, CCC)"
+Network createNetwork(const input_t &lines) {
+    Network net;
+    net.next[0].assign(NODE_IDS, 0);
+    net.next[1].assign(NODE_IDS, 0);
+    for (const std::string &line : lines) {
+        if (line.size() < 15) continue;
+        const uint16_t node = encodeName(&line[0]);
+        net.next[0][node] = encodeName(&line[7]);
+        net.next[1][node] = encodeName(&line[12]);
+        net.nodes.push_back(node);
+        net.exists[node] = true;
+        net.is_end[node] = endsWith(node, 'Z');
     }
-    #endif
+    return net;
+}
 
-    Node &curr_node = nodes["AAA"];
-    size_t steps = 0;
-    while (curr_node.name != "ZZZ") {
-        char instr = instructions[steps++ % (len)];
-        #ifdef _DEBUG
-        std::cout << std::format("Instuction: \"{}\"\n", instr);
-        #endif
+
+// Instructions as indices into Network::next
+std::vector<uint8_t> getDirections(const std::string &instructions) {
+    std::vector<uint8_t> dirs;
+    for (char instr : instructions) {
         switch (instr)
         {
-        case 'R':
-            curr_node = *curr_node.right;
-            break;
         case 'L':
-            curr_node = *curr_node.left;
+            dirs.push_back(0);
+            break;
+
+        case 'R':
+            dirs.push_back(1);
             break;
+
         default:
             std::cout << "Unreachable! Instuction: \"" << instr << "\"" << std::endl;
             exit(1);
         }
     }
+    return dirs;
+}
+
+
+// Part 1 answer when the network lacks AAA or ZZZ
+constexpr int NO_PATH = -1;
+
+int part1(const input_t &in) {
+    const std::vector<uint8_t> dirs = getDirections(in[0]);
+    const size_t len = dirs.size();
+
+    Network net = createNetwork(std::vector(in.begin()+2, in.end()));
+    #ifdef _DEBUG
+    for (uint16_t node : net.nodes) {
+        std::cout << std::format("Node \"{}\", Left: {}, Right {}\n", decodeName(node),
+            decodeName(net.next[0][node]), decodeName(net.next[1][node]));
+    }
+    #endif
+
+    uint16_t curr_node = encodeName("AAA");
+    const uint16_t end_node = encodeName("ZZZ");
+    // Without both the walk below would never end
+    if (!net.exists[curr_node] || !net.exists[end_node]) return NO_PATH;
+    size_t steps = 0;
+    while (curr_node != end_node) {
+        curr_node = net.next[dirs[steps++ % len]][curr_node];
+    }
 
     return steps;
 }
 
 
-std::vector<const Node *> getStartingNodes(std::unordered_map<std::string, Node> &nodes) {
-    std::vector<const Node *> ret;
-    for (const auto &kv : nodes) {
-        const Node *node = &nodes[kv.first];
-        const std::string &name = node->name;
-        if (name.ends_with('A')) {
+std::vector<uint16_t> getStartingNodes(const Network &net) {
+    std::vector<uint16_t> ret;
+    for (uint16_t node : net.nodes) {
+        if (endsWith(node, 'A')) {
             ret.push_back(node);
         }
     }
@@ -136,58 +156,49 @@ std::vector<const Node *> getStartingNodes(std::unordered_map<std::string, Node>
 }
 
 
-void makeStep(const Node *&curr_node, char instr, std::unordered_map<std::string, Node> &nodes) {
-    switch (instr)
-    {
-    case 'R':
-        curr_node = curr_node->right;
-        break;
-    
-    case 'L':
-        curr_node = curr_node->left;
-        break;
-
-    default:
-        std::cout << "Unreachable! Instuction: \"" << instr << "\"" << std::endl;
-        exit(1);
-    }
-}
-
-uint64_t lcm(const std::vector<uint64_t> &nums) {
-    if (nums.size() == 2) {
-        return nums[0]*nums[1] / std::gcd(nums[0], nums[1]);
-    }
-    return std::lcm(nums[0], lcm(std::vector(nums.begin()+1, nums.end())));
-}
+struct Ghost {
+    uint16_t node;
+    size_t instr;   // index of the next instruction
+};
 
 
 uint64_t part2(const input_t &in) {
-    std::string instructions = in[0];
-    size_t len = instructions.size();
+    const std::vector<uint8_t> dirs = getDirections(in[0]);
+    const size_t len = dirs.size();
 
-    std::unordered_map<std::string, Node> nodes = createNodeMap(std::vector(in.begin()+2, in.end()));
-    std::vector<const Node *> starting_nodes = getStartingNodes(nodes);
+    Network net = createNetwork(std::vector(in.begin()+2, in.end()));
+    std::vector<uint16_t> starting_nodes = getStartingNodes(net);
     #ifdef _DEBUG
     std::cout << "Starting positions: ";
     for (const auto &n : starting_nodes) {
-        std::cout << std::format("{}, ", n->name);
+        std::cout << std::format("{}, ", decodeName(n));
     }
     std::cout << std::endl;
     #endif
-    
 
-    std::vector<uint64_t> node_steps;
-    for (size_t i = 0; i < starting_nodes.size(); i++) {
-        size_t steps = 0;
-        const Node *curr_node = starting_nodes[i];
-        while (!curr_node->name.ends_with('Z')) {
-            makeStep(curr_node, instructions[steps % len], nodes);
-            ++steps;
-        }
-        node_steps.push_back(steps);
+    // Each ghost ends up in a cycle of (node, instruction) states. The steps
+    // it sits on a Z node are combined across ghosts instead of assuming the
+    // first Z is the period.
+    std::vector<utils::Cycle> cycles;
+    for (uint16_t start : starting_nodes) {
+        utils::CycleDetector detector(
+            [&]() { return Ghost{start, 0}; },
+            [&](Ghost &g) {
+                g.node = net.next[dirs[g.instr]][g.node];
+                g.instr = (g.instr + 1) % len;
+            },
+            [](const Ghost &g) {
+                return utils::mix64((uint64_t)g.node << 32 | g.instr);
+            },
+            [&](const Ghost &g) { return net.is_end[g.node]; });
+        cycles.emplace_back(detector.run());
+        #ifdef _DEBUG
+        std::cout << std::format("{}: prefix {}, period {}, hits {}\n",
+            decodeName(start), cycles.back().prefix, cycles.back().period, cycles.back().hits.size());
+        #endif
     }
 
-    return lcm(node_steps);
+    return utils::firstCommonHit(cycles).value_or(0);
 }
 
 
@@ -207,7 +218,11 @@ int main(int argc, char *argv[]) {
 
     auto res1 = part1(lines1);
     std::cout << "-----PART 1-----\n";
-    std::cout << "number of steps: " << res1 << std::endl;
+    if (res1 == NO_PATH) {
+        std::cout << "no AAA/ZZZ node in the network" << std::endl;
+    } else {
+        std::cout << "number of steps: " << res1 << std::endl;
+    }
     
     #ifdef _DEBUG
     path = std::filesystem::path(parent + "/" + stem + "-2" + ext);
@@ -7,6 +7,8 @@
 #include <string>
 #include <complex>
 
+#include "recycles.h"
+
 
 typedef std::vector<std::string> input_t;
 typedef std::complex<int64_t> Position;
@@ -155,119 +157,26 @@ uint64_t part1(const input_t &in) {
 }
 
 
-enum class Tile{
-    Vertical    = 0,
-    Corner      = 2,
-    None        = 3,
-    Horizontal  = 4,
-    NotMainLoop = 5,
-    Unknown     = 6,
-};
-
-
-Tile getTile(char c) {
-    switch (c)
-    {
-    case '.':
-        return Tile::None;
-    case '|':
-        return Tile::Vertical;
-    case '-':
-        return Tile::Horizontal;
-    case 'S':
-    case 'F':
-    case '7':
-    case 'L':
-    case 'J':
-        return Tile::Corner;
-
-    default:
-        #ifdef _DEBUG
-        std::cout << std::format("Unreachable! Symbol \'{}\'!", c) << std::endl;
-        exit(1);
-        #endif
-        return Tile::Unknown;
-    }
-}
-
-
-size_t raytrace(const std::vector<std::vector<Tile>> &loop, Position point, const input_t &grid) {
-    size_t intersections = 0;
-    size_t y = point.imag();
-
-    bool wasempty = true;
-    for (int x = point.real(); x < loop[0].size(); x++) {
-        if (loop[y][x] == Tile::Vertical){
-            intersections++;
-        } else if (loop[y][x] == Tile::Corner) {
-            char c = atPos(grid, Position(x, y));
-            int i = x+1;
-            for (; i < loop[0].size() && loop[y][i] == Tile::Horizontal; i++) {}
-            if (c == 'F') {
-                if (atPos(grid, Position(i, y)) != 'J') intersections++;
-            } else if (c == 'L') {
-                if (atPos(grid, Position(i, y)) != '7') intersections++;
-            } else {
-                intersections++;
-            }
-        }
-    }
-    return intersections;
-}
-
 uint64_t part2(const input_t &in) {
-    using namespace std::complex_literals;
+    // The loop is a lattice polygon: shoelace gives its area and Pick's
+    // theorem the number of tiles it encloses.
     Position pos = getStart(in);
     std::vector<Position> neighbors = getValidNeighbors(in ,pos);
+    utils::geometry::LatticePolygon loop;
+    loop.push(pos);
 
-    std::vector<std::vector<Tile>> loop;
-    for (size_t i = 0; i < in.size(); i++) {
-        loop.push_back(std::vector(in[0].size(), Tile::None));
-    }
-
-    Position n = neighbors[0];
-    Position dir = n - pos;
+    Position dir = neighbors[0] - pos;
     pos += dir;
     char c = atPos(in, pos);
-    loop[pos.imag()][pos.real()] = getTile(c);
     while (c != 'S') {
+        loop.push(pos);
         dir = getDirection(c, dir);
         pos += dir;
         c = atPos(in, pos);
-        loop[pos.imag()][pos.real()] = getTile(c);
-    }
-
-    uint64_t numPoints = 0;
-    for (int64_t y = 0; y < in.size(); y++) {
-        for (int64_t x = 0; x < in[0].size(); x++) {
-            size_t inter = 0;
-            if (loop[y][x] == Tile::None)
-                inter = raytrace(loop, Position(x, y), in);
-            
-            if (inter % 2 != 0) numPoints++;
-            #ifdef _DEBUG
-            if (loop[y][x] != Tile::None) {
-                std::cout << in[y][x];
-            } else {
-                std::cout << (inter % 2 != 0);
-            }
-            #endif 
-        }
-        #ifdef _DEBUG
-        std::cout << std::endl;
-        #endif 
     }
+    loop.push(pos);
 
-
-    #ifdef DEBUG_
-    for(auto line : loop) {
-        for (auto j : line) {
-            std::cout << j;
-        }
-        std::cout << std::endl;
-    }
-    #endif
-    return numPoints;
+    return loop.interior();
 }
 
 
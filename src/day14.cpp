@@ -9,6 +9,8 @@
 #include <complex>
 #include <algorithm>
 
+#include "recycles.h"
+
 
 typedef std::vector<std::string> input_t;
 typedef uint8_t  u8;
@@ -159,67 +161,32 @@ void performCycle(input_t &grid) {
 }
 
 
-bool operator ==(const input_t &lhs, const input_t &rhs) {
-    for (i32 y = 0; y < lhs.size(); ++y) {
-        for (i32 x = 0; x < lhs[0].size(); ++x){
-            if (lhs[y][x] == rhs[y][x]) return false; 
-        }
-    }
-    return true;
-}
-
-
-bool operator !=(const input_t &lhs, const input_t &rhs) {
-    for (i32 y = 0; y < lhs.size(); ++y) {
-        for (i32 x = 0; x < lhs[0].size(); ++x){
-            if (lhs[y][x] != rhs[y][x]) return true; 
-        }
-    }
-    return false;
-}
-
 u64 part2(const input_t &in) {
-    std::vector<input_t> grids = {in};
-    input_t tmp = in;
-
-    i32 cycle_start = -1;
-
     debug_println("Original grid:");
-    for (const auto &line : grids[0]) {
+    for (const auto &line : in) {
         debug_println("{}", line);
     }
-    
-    #ifdef _DEBUG
-    i32 i = 0;
-    #endif
-    while (true) {
-        performCycle(tmp);
-        
-        #ifdef _DEBUG
-        debug_println("");
-        debug_println("Cycle {}:", ++i);
-        for (const auto &line : tmp) {
-            debug_println("{}", line);
-        }
-        #endif
 
-        if (auto it = std::find(grids.begin(), grids.end(), tmp); it == grids.end()) {
-            grids.push_back(tmp);
-        } else {
-            cycle_start = it - grids.begin();
-            std::cout << cycle_start << std::endl;
-            break;
-        }
-    }
+    utils::CycleDetector detector(
+        [&]() { return in; },
+        performCycle,
+        [](const input_t &grid) {
+            u64 fp = 0;
+            for (const auto &line : grid) fp = utils::fingerprint(line, fp);
+            return fp;
+        },
+        [](const input_t &) { return false; });
+    const utils::Cycle cycle = detector.run();
+    debug_println("Cycle starts after {} spins, period {}", cycle.prefix, cycle.period);
 
-    u64 no_cycles = 1000000000;
-    u64 cycle_len = grids.size() - cycle_start;
-    u64 non_repeat_cycles = cycle_start + 1;
-    u64 repeat_cycles = no_cycles - non_repeat_cycles;
-    const input_t &grid = grids[cycle_start + (repeat_cycles % cycle_len) + 1];
+    const u64 no_cycles = 1000000000;
+    input_t grid = in;
+    for (u64 i = 0; i < cycle.reduce(no_cycles); ++i) {
+        performCycle(grid);
+    }
 
     u64 score = 0;
-    for (i32 y = 0; y < grids.rbegin()->size(); ++y) {
+    for (i32 y = 0; y < grid.size(); ++y) {
         for (i32 x = 0; x <  grid[0].size(); ++x){
             if (grid[y][x] == 'O') score += grid.size() - y; 
         }
@@ -11,7 +11,9 @@
 #include <unordered_set>
 #include <algorithm>
 #include <deque>
+#include <array>
 
+#include "recycles.h"
 #include "robin_hood.h"
 
 
@@ -25,24 +27,8 @@
 
 
 typedef std::vector<std::string> input_t;
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t   i8;
-typedef int16_t  i16;
-typedef int32_t  i32;
-typedef int64_t  i64;
-typedef size_t   usize;
-
-typedef std::complex<i64> Pos;
-typedef std::complex<i64> Dir;
-typedef std::complex<i64> Rot;
-
-const Dir NORTH( 0,-1);
-const Dir SOUTH( 0, 1);
-const Dir WEST (-1, 0);
-const Dir EAST ( 1, 0);
+
+using namespace utils;
 
 const std::array<Dir, 4> DIRS = {NORTH, SOUTH, EAST, WEST};
 
@@ -92,76 +78,18 @@ input_t parse_inputs(const std::string &filename) {
 }
 
 
-template<typename T = u32>
-class Grid {
-public:
-    usize rows;
-    usize cols;
-
-    Grid(usize rows_, usize cols_, const T &value) : rows(rows_), cols(cols_), m_data(rows*cols, value) {}
-
-    Grid(const input_t &in) : rows(in.size()), cols(in[0].size()), m_data(rows*cols, 0) {
-        for (usize y = 0; y < in.size(); ++y) {
-            for (usize x = 0; x < in[0].size(); ++x) {
-                (*this)(x, y) = in[y][x] - '0';
-            }
-        }
-    }
-
-    inline T& operator()(usize x, usize y) {
-        if (x >= cols) {
-            debug_println("x {} exceeds total number of columns({})!", x, cols-1);
-        } else if (y >= rows) {
-            debug_println("y {} exceeds total number of rows({})!", y, rows-1);
-        }
-        return m_data[y*cols + x];
-    }
-
-    inline T& operator()(Pos pos) {
-        return (*this)(pos.real(), pos.imag());
-    }
-
-    inline const T& operator()(usize x, usize y) const {
-        if (x >= cols) {
-            debug_println("x {} exceeds total number of columns({})!", x, cols-1);
-        } else if (y >= rows) {
-            debug_println("y {} exceeds total number of rows({})!", y, rows-1);
-        }
-        return m_data[y*cols + x];
-    }
+// Dijkstra touches the neighbourhood of each cell, tiles keep it in cache.
+using HeatGrid = Grid<u32, Tiled<8>>;
 
-    inline const T& operator()(Pos pos) const {
-        return (*this)(pos.real(), pos.imag());
-    }
 
-    std::string printToString() const {
-        std::stringstream ss;
-        for (size_t y = 0; y < rows; y++) {
-            for (size_t x = 0; x < cols; x++) {
-                ss << (*this)(x, y) << ' ';
-            }
-            ss << "\n";
+HeatGrid parseGrid(const input_t &in) {
+    HeatGrid grid(in.size(), in[0].size(), 0);
+    for (usize y = 0; y < grid.rows; ++y) {
+        for (usize x = 0; x < grid.cols; ++x) {
+            grid(x, y) = in[y][x] - '0';
         }
-        return ss.str();
-    }
-
-    bool isOutOfBound(i32 x, i32 y) const {
-        return x < 0 || y < 0 || x >= (i32)cols || y >= (i32)rows;
     }
-
-    bool isOutOfBound(const Pos &pos) const {
-        return isOutOfBound(pos.real(), pos.imag());
-    }
-
-private:
-    std::vector<T> m_data;
-};
-
-
-template<typename T>
-std::ostream& operator<<(std::ostream& os, const Grid<T>& grid) {
-    os << grid.printToString();
-    return os;
+    return grid;
 }
 
 
@@ -195,7 +123,7 @@ struct State {
 };
 
 
-u32 shortestPath(Pos start, const Pos &end, const Grid<> &grid, const u32 min_steps=0, const u32 max_steps=3) {
+u32 shortestPath(Pos start, const Pos &end, const HeatGrid &grid, const u32 min_steps=0, const u32 max_steps=3) {
     std::priority_queue<State, std::vector<State>, std::greater<State>> pq;
     pq.emplace(0, start, Dir(0, 0), 0);
     robin_hood::unordered_set<State, State> seen;
@@ -232,7 +160,7 @@ u32 shortestPath(Pos start, const Pos &end, const Grid<> &grid, const u32 min_st
 
 
 u64 part1(const input_t &in) {
-    Grid<> grid(in);
+    HeatGrid grid = parseGrid(in);
     Pos start(0, 0);
     Pos end(grid.cols-1, grid.rows-1);
     return shortestPath(start, end, grid);
@@ -240,7 +168,7 @@ u64 part1(const input_t &in) {
 
 
 u64 part2(const input_t &in) {
-    Grid<> grid(in);
+    HeatGrid grid = parseGrid(in);
     Pos start(0, 0);
     Pos end(grid.cols-1, grid.rows-1);
     return shortestPath(start, end, grid, 4, 10);
@@ -9,6 +9,9 @@
 #include <numeric>
 #include <deque>
 #include <algorithm>
+#include <array>
+
+#include "recycles.h"
 
 
 typedef std::vector<std::string> input_t;
@@ -85,10 +88,10 @@ Dir dirFromChar(char c) {
 }
 
 
-std::vector<Pos> digOutline(const input_t &instrs) {
+utils::geometry::LatticePolygon digOutline(const input_t &instrs) {
     Pos pos(1000, 1000);
-    std::vector<Pos> vertices{pos};
-
+    utils::geometry::LatticePolygon outline;
+    outline.push(pos);
 
     for (const std::string & instr : instrs) {
         std::istringstream iss(instr);
@@ -98,43 +101,15 @@ std::vector<Pos> digOutline(const input_t &instrs) {
         iss >> steps;
 
         pos += steps * dirFromChar(direction);
-        vertices.push_back(pos);
-    }
-    return vertices;
-}
-
-
-i64 perimeter(const std::vector<Pos> &outline) {
-    i64 peri = 0;
-    for (usize i = 0; i < outline.size()-1; ++i) {
-        i64 x1 = outline[i].real();
-        i64 y1 = outline[i].imag();
-        i64 x2 = outline[i+1].real();
-        i64 y2 = outline[i+1].imag();
-        peri += std::abs(x2 - x1 + y2 - y1);
-    }
-    return peri;
-}
-
-i64 areaDouble(const std::vector<Pos> &outline) {
-    // https://en.wikipedia.org/wiki/Shoelace_formula
-    // https://en.wikipedia.org/wiki/Pick%27s_theorem
-    i64 area = 0;
-
-    for (usize i = 0; i < outline.size()-1; ++i) {
-        i64 x1 = outline[i].real();
-        i64 y1 = outline[i].imag();
-        i64 x2 = outline[i+1].real();
-        i64 y2 = outline[i+1].imag();
-        area += (y1 + y2)*(x1 - x2);
+        outline.push(pos);
     }
-    return area;
+    return outline;
 }
 
 
 u64 part1(const input_t &in) {
-    std::vector<Pos> vertices = digOutline(in);
-    return (areaDouble(vertices) + perimeter(vertices))/2 + 1;
+    auto outline = digOutline(in);
+    return outline.interior() + outline.boundary();
 }
 
 
@@ -173,8 +148,8 @@ input_t fixInstructions(const input_t &in) {
 u64 part2(const input_t &in) {
     input_t instrs = fixInstructions(in);
 
-    std::vector<Pos> vertices = digOutline(instrs);
-    return (areaDouble(vertices) + perimeter(vertices))/2 + 1;
+    auto outline = digOutline(instrs);
+    return outline.interior() + outline.boundary();
 }
 
 
@@ -7,6 +7,9 @@
 #include <string>
 #include <numeric>
 #include <algorithm>
+#include <array>
+
+#include "recycles.h"
 
 
 #ifdef _DEBUG
@@ -19,15 +22,8 @@
 
 
 typedef std::vector<std::string> input_t;
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t   i8;
-typedef int16_t  i16;
-typedef int32_t  i32;
-typedef int64_t  i64;
-typedef size_t   usize;
+
+using namespace utils;
 
 
 void usage(const std::string &program_name) {
@@ -431,39 +427,24 @@ void findAcceptPaths(const std::string &start, const std::vector<Workflow> &wfs,
 }
 
 
-struct Limits {
-    Part min;
-    Part max;
-};
+// Accepted values of each rating, indexed like `Part::operator[]`
+typedef std::array<IntervalSet<u32>, 4> Limits;
 
 Limits findAcceptPathLimits(const std::vector<Rule> &accept_path) {
-    Limits l{Part(1), Part(4000)};
+    Limits l;
+    l.fill(IntervalSet<u32>(1, 4001));
 
     for (const Rule &rule : accept_path) {
         if (rule.cmp == Cmp::None) continue;
-        
-        if (rule.cmp == Cmp::Less    && rule.rating == Rating::A)
-            l.max.a = std::min(l.max.a, rule.limit-1);
-        else if (rule.cmp == Cmp::Less    && rule.rating == Rating::M)
-            l.max.m = std::min(l.max.m, rule.limit-1);
-        else if (rule.cmp == Cmp::Less    && rule.rating == Rating::X)
-            l.max.x = std::min(l.max.x, rule.limit-1);
-        else if (rule.cmp == Cmp::Less    && rule.rating == Rating::S)
-            l.max.s = std::min(l.max.s, rule.limit-1);
-        else if (rule.cmp == Cmp::Greater && rule.rating == Rating::A)
-            l.min.a = std::max(l.min.a, rule.limit+1);
-        else if (rule.cmp == Cmp::Greater && rule.rating == Rating::M)
-            l.min.m = std::max(l.min.m, rule.limit+1);
-        else if (rule.cmp == Cmp::Greater && rule.rating == Rating::X)
-            l.min.x = std::max(l.min.x, rule.limit+1);
-        else if (rule.cmp == Cmp::Greater && rule.rating == Rating::S)
-            l.min.s = std::max(l.min.s, rule.limit+1);
-        
-        if (l.min.a > l.max.a || l.min.m > l.max.m || l.min.s > l.max.s || l.min.x > l.max.x) {
-            l.min = Part(0);
-            l.max = Part(0);
-            return l;
-        }
+
+        IntervalSet<u32> &set = l[static_cast<usize>(rule.rating) - 1];
+        if (rule.cmp == Cmp::Less)
+            set = set.split(rule.limit).first;
+        else
+            set = set.split(rule.limit + 1).second;
+
+        if (set.empty())
+            return Limits{};
     }
     return l;
 }
@@ -484,13 +465,9 @@ u64 part2(const input_t &in) {
     debug_println("Accept paths:");
     for (const auto &ap : accept_paths) {
         Limits l = findAcceptPathLimits(ap);
-        i64 total = 1;
-        for (usize i = 0; i < 4; ++i) {
-            if (l.min[i] == l.max[i]) {
-                total = 0;
-                break;
-            } 
-            total *= l.max[i] - l.min[i] + 1;
+        u64 total = 1;
+        for (const auto &set : l) {
+            total *= set.size();
         }
         total_combinations += total;
         debug_println("{} total = {}", ruleListToString(ap), total);
@@ -10,6 +10,8 @@
 #include <deque>
 #include <memory>
 
+#include "recycles.h"
+
 #ifdef _DEBUG
     #define debug_println(fmt, ...) std::cout << std::format((fmt), ##__VA_ARGS__) << std::endl
     #define debug_print(fmt, ...) std::cout << std::format((fmt), ##__VA_ARGS__)
@@ -84,13 +86,16 @@ public:
 
 using Universe=std::vector<std::unique_ptr<Module>>;
 Universe universe{};
+// `universe[id]` is the module with that id. Outputs without a module
+// (e.g. "rx") get ids past the end of `universe`.
+utils::IdMap<std::string> module_ids{};
+utils::CsrGraph<> wiring{};
 
 
 Universe::iterator findInUniverse(const std::string &name) {
-    for (auto it = universe.begin(); it < universe.end(); ++it) {
-        if ((*it)->name == name) return it;
-    }
-    return universe.end();
+    auto id = module_ids.find(name);
+    if (!id || *id >= universe.size()) return universe.end();
+    return universe.begin() + *id;
 }
 
 
@@ -126,19 +131,15 @@ public:
 
 class Conjunction : public Module {
 public:
-    std::vector<std::string> inputs;
+    std::vector<u32> inputs;
 
     Conjunction(const std::string &n, const std::vector<std::string> &out, 
-        const std::vector<std::string> &in = {}) 
+        const std::vector<u32> &in = {}) 
         : Module(n, out), inputs(in) {}
 
     virtual Pulse broadcast(Pulse p) override {
-        for (const auto &in : inputs) {
-            auto it = findInUniverse(in);
-            if (it == universe.end()) {
-                debug_println("Unknown module with name \"{}\"", in);
-            }
-            if ((*it)->last == Pulse::Low) {
+        for (u32 in : inputs) {
+            if (universe[in]->last == Pulse::Low) {
                 last = Pulse::High;
                 return last;
             }
@@ -154,8 +155,8 @@ public:
             oss << o << (o == *outputs.rbegin() ? "]" : ", ");
         }
         oss << ", in: [";
-        for (const auto & i : inputs) {
-            oss << i << (i == *inputs.rbegin() ? "]}" : ", ");
+        for (u32 i : inputs) {
+            oss << module_ids.key(i) << (i == *inputs.rbegin() ? "]}" : ", ");
         }
         return oss.str();
     }
@@ -201,6 +202,9 @@ public:
 
 
 void createUniverse(const input_t &in) {
+    universe.clear();
+    module_ids = {};
+
     for (const auto &line : in) {
         std::istringstream iss;
         usize idx = line.find(" -> ");
@@ -235,18 +239,25 @@ void createUniverse(const input_t &in) {
         }
     }
 
-    // Add inputs for Conjunction
+    // Modules get their index in `universe` as id, then the wiring is built
     for (const auto & mod : universe) {
-        const auto &out = mod->outputs;
-        for (const auto &o : out) {
-            auto it =  findInUniverse(o);
-            if (it == universe.end()) {
-                debug_println("Unknown module with name \"{}\"", o);
-                continue;
-            }
-            Conjunction *p = dynamic_cast<Conjunction*>(it->get());
-            if (p) {
-                p->inputs.emplace_back(mod->name);
+        module_ids(mod->name);
+    }
+    std::vector<utils::CsrGraph<>::EdgeTriple> edges;
+    for (u32 id = 0; id < universe.size(); ++id) {
+        for (const auto &o : universe[id]->outputs) {
+            edges.push_back({id, module_ids(o), 1});
+        }
+    }
+    wiring = utils::CsrGraph<>(module_ids.size(), edges);
+
+    // Add inputs for Conjunction
+    const utils::CsrGraph<> inputs = wiring.reversed();
+    for (u32 id = 0; id < universe.size(); ++id) {
+        Conjunction *p = dynamic_cast<Conjunction*>(universe[id].get());
+        if (p) {
+            for (const auto &e : inputs.neighbors(id)) {
+                p->inputs.push_back(e.to);
             }
         }
     }
@@ -254,12 +265,12 @@ void createUniverse(const input_t &in) {
 
 
 void pushButton(i64 &nlow, i64 &nhigh) {
-    std::deque<std::pair<Pulse, std::unique_ptr<Module>&>> queue;
+    std::deque<std::pair<Pulse, u32>> queue;
     auto it = findInUniverse("broadcaster");
     if (it == universe.end()) {
         debug_println("Broadcaster does not exists in Universe");
     }
-    queue.emplace_back(Pulse::Low, *it);
+    queue.emplace_back(Pulse::Low, it - universe.begin());
 
     debug_println("button -low-> broadcaster");
     nlow++; // button push = 1 low
@@ -267,22 +278,21 @@ void pushButton(i64 &nlow, i64 &nhigh) {
         auto pair = queue.front();
         queue.pop_front();
         Pulse inPulse = pair.first;
-        std::unique_ptr<Module> &mod = pair.second;
+        std::unique_ptr<Module> &mod = universe[pair.second];
 
         Pulse outPulse = mod->broadcast(inPulse);
         if (outPulse != Pulse::NoPulse) {
-            if (outPulse == Pulse::Low) nlow += mod->outputs.size();
-            else                        nhigh += mod->outputs.size();
+            if (outPulse == Pulse::Low) nlow += wiring.degree(pair.second);
+            else                        nhigh += wiring.degree(pair.second);
             
-            for (const auto &o : mod->outputs) {
-                debug_println("{} -{}-> {}", mod->name, outPulse==Pulse::Low?"low":"high", o);
+            for (const auto &o : wiring.neighbors(pair.second)) {
+                debug_println("{} -{}-> {}", mod->name, outPulse==Pulse::Low?"low":"high", module_ids.key(o.to));
                 
-                it = findInUniverse(o);
-                if (it == universe.end()) {
-                    debug_println("Output {} for {} does not exists in Universe", o, mod->toString());
+                if (o.to >= universe.size()) {
+                    debug_println("Output {} for {} does not exists in Universe", module_ids.key(o.to), mod->toString());
                     continue;
                 }
-                queue.emplace_back(outPulse, *it);
+                queue.emplace_back(outPulse, o.to);
             }
         }
     }
@@ -315,58 +325,81 @@ i64 part1(const input_t &in) {
 }
 
 
-i64 findHighCycles(const std::string &mod_name) {
-    i64 seen = 0;
-    for (u64 i = 1;; ++i) {
-        std::deque<std::pair<Pulse, std::unique_ptr<Module>&>> queue;
-        auto it = findInUniverse("broadcaster");
-        if (it == universe.end()) {
-            debug_println("Broadcaster does not exists in Universe");
-        }
-        queue.emplace_back(Pulse::Low, *it);
-
-        while (!queue.empty()) {
-            auto pair = queue.front();
-            queue.pop_front();
-            Pulse inPulse = pair.first;
-            std::unique_ptr<Module> &mod = pair.second;
+// Pushes the button once and returns whether module `watch` sent a high pulse
+bool pushButtonWatch(u32 watch) {
+    std::deque<std::pair<Pulse, u32>> queue;
+    auto it = findInUniverse("broadcaster");
+    if (it == universe.end()) {
+        debug_println("Broadcaster does not exists in Universe");
+    }
+    queue.emplace_back(Pulse::Low, it - universe.begin());
+    bool fired = false;
 
-            Pulse outPulse = mod->broadcast(inPulse);
-            
-            if (mod_name == mod->name && outPulse == Pulse::High) {
-                if (seen == 0)
-                    seen = i;
-                else
-                    return i - seen;
-            }
-            
-            if (outPulse != Pulse::NoPulse) {
-                for (const auto &o : mod->outputs) {
-                    it = findInUniverse(o);
-                    if (it == universe.end()) {
-                        continue;
-                    }
-                    queue.emplace_back(outPulse, *it);
-                }
+    while (!queue.empty()) {
+        auto pair = queue.front();
+        queue.pop_front();
+        Pulse inPulse = pair.first;
+        Pulse outPulse = universe[pair.second]->broadcast(inPulse);
+        
+        if (pair.second == watch && outPulse == Pulse::High)
+            fired = true;
+        
+        if (outPulse != Pulse::NoPulse) {
+            for (const auto &o : wiring.neighbors(pair.second)) {
+                if (o.to < universe.size())
+                    queue.emplace_back(outPulse, o.to);
             }
         }
     }
+    return fired;
+}
+
+
+// Modules whose state can influence module `id`, including itself
+std::vector<u32> findAncestors(u32 id) {
+    const auto tree = wiring.reversed().bfs(id);
+    std::vector<u32> ret;
+    for (u32 i = 0; i < universe.size(); ++i) {
+        if (tree.reached(i)) ret.push_back(i);
+    }
+    return ret;
 }
 
 
-i64 lcm(const std::vector<i64> &nums) {
-    if (nums.size() == 0) 
-        return 0;
+struct PressState {
+    bool fired;   // `mod_name` sent a high pulse during the last press
+};
 
-    if (nums.size() == 1)
-        return nums[0];
 
-    return std::lcm(nums[0], lcm(std::vector(nums.begin()+1, nums.end())));
+utils::Cycle findHighCycle(const std::string &mod_name, const input_t &in) {
+    // Only the modules upstream of `mod_name` decide when it fires, so the
+    // cycle is found on their state alone, which repeats much sooner than
+    // the whole universe.
+    createUniverse(in);
+    const u32 watch = findInUniverse(mod_name) - universe.begin();
+    const std::vector<u32> ancestors = findAncestors(watch);
+
+    utils::CycleDetector detector(
+        [&]() {
+            createUniverse(in);
+            return PressState{false};
+        },
+        [&](PressState &s) { s.fired = pushButtonWatch(watch); },
+        [&](const PressState &s) {
+            u64 fp = s.fired;
+            for (u32 i : ancestors) {
+                const Module *mod = universe[i].get();
+                const FlipFlop *ff = dynamic_cast<const FlipFlop*>(mod);
+                fp = utils::hashCombine(fp, static_cast<u64>(mod->last) << 1 | (ff && ff->on));
+            }
+            return fp;
+        },
+        [](const PressState &s) { return s.fired; });
+    return detector.run();
 }
 
 
 i64 part2(const input_t &in) {
-    universe.resize(0);
     createUniverse(in);
 
     std::vector<std::string> rx_inputs;
@@ -399,14 +432,13 @@ i64 part2(const input_t &in) {
         }
     }
 
-    std::vector<i64> cycles{};
-    for (const auto &in : rx_inputs_depth2) {
-        cycles.emplace_back(findHighCycles(in));
-        debug_println("cycles of \"{}\": {}", in, *cycles.rbegin());
-        std::cout << std::format("cycles of \"{}\": {}\n", in, *cycles.rbegin());
+    std::vector<utils::Cycle> cycles{};
+    for (const auto &name : rx_inputs_depth2) {
+        cycles.emplace_back(findHighCycle(name, in));
+        std::cout << std::format("cycles of \"{}\": {}\n", name, cycles.rbegin()->period);
     }
 
-    return lcm(cycles);
+    return utils::firstCommonHit(cycles).value_or(-1);
 }
 
 
@@ -13,6 +13,7 @@
 #include <assert.h>
 #include <unordered_set>
 
+#include "recycles.h"
 #include "robin_hood.h"
 
 
@@ -26,24 +27,10 @@
 
 
 typedef std::vector<std::string> input_t;
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t   i8;
-typedef int16_t  i16;
-typedef int32_t  i32;
-typedef int64_t  i64;
-typedef size_t   usize;
-
-
-using Pos=std::complex<i32>;
-using Dir=std::complex<i32>;
-constexpr Dir NORTH( 0,-1);
-constexpr Dir SOUTH( 0, 1);
-constexpr Dir EAST ( 1, 0);
-constexpr Dir WEST (-1, 0);
-constexpr std::array<Dir, 4> ALL_DIRS{NORTH, SOUTH, EAST, WEST};
+
+using namespace utils;
+
+const std::array<Dir, 4> ALL_DIRS{NORTH, SOUTH, EAST, WEST};
 
 
 void usage(const std::string &program_name) {
@@ -119,131 +106,13 @@ std::ostream& operator<<(std::ostream &os, Tile t) {
 }
 
 
-template<typename T = Tile> 
-class Grid {
-public:
-    usize rows;
-    usize cols;
-
-    Grid(usize rows_, usize cols_, const T &value) : rows(rows_), cols(cols_), m_data(rows*cols, value) {}
-    Grid(usize rows_, usize cols_, i32 value) : rows(rows_), cols(cols_), m_data(rows*cols, static_cast<Tile>(value)) {}
-
-    Grid<T>& operator=(const Grid<T> &g) {
-        rows = g.rows;
-        cols = g.cols;
-        m_data = g.m_data;
-        return *this;
-    }
-
-    std::vector<Pos> getPointsAtRadius(Pos center,i32 radius) {
-        if (radius == 0)
-            return {center};
-
-        std::vector<Pos> ret;
-        for (i32 x = radius, y = 0; x >= 0; --x, ++y) {
-            if (y == 0) {
-                if (!isOutOfBound(center + Pos(x, 0))) ret.emplace_back(center + Pos(x, 0));
-                if (!isOutOfBound(center - Pos(x, 0))) ret.emplace_back(center - Pos(x, 0));
-                continue;
-            }
-
-            if (x == 0) {
-                if (!isOutOfBound(center + Pos(0, y))) ret.emplace_back(center + Pos(0, y));
-                if (!isOutOfBound(center - Pos(0, y))) ret.emplace_back(center - Pos(0, y));
-                continue;
-            }
-            
-            const std::array<Pos,4> all_points{ center + Pos(x, y),
-                                                center + Pos(-x, y),
-                                                center + Pos(x, -y),
-                                                center + Pos(-x, -y)};
-            for (const Pos &p : all_points) {
-                if (!isOutOfBound(p)) ret.emplace_back(p);
-            }
-        }
-        return ret;
-    }
-
-    i32 count(const T& t) const {
-        i32 count = 0;
-        for (usize y = 0; y < rows; y++) {
-            for (usize x = 0; x < cols; x++) {
-                if (at(x, y) == t) count++;
-            }
-        }
-        return count;
-    }
-
-    T& at(usize x, usize y) {
-        if (x >= cols) {
-            debug_println("x {} exceeds total number of columns({})!", x, cols-1);
-        } else if (y >= rows) {
-            debug_println("y {} exceeds total number of rows({})!", y, rows-1);
-        }
-        return m_data[y*cols + x];
-    }
-
-    const T& at(usize x, usize y) const {
-        if (x >= cols) {
-            debug_println("x {} exceeds total number of columns({})!", x, cols-1);
-        } else if (y >= rows) {
-            debug_println("y {} exceeds total number of rows({})!", y, rows-1);
-        }
-        return m_data[y*cols + x];
-    }
-
-    T& operator()(usize x, usize y) { return at(x, y); }
-
-    T& operator()(Pos pos) { return at(pos.real(), pos.imag()); }
-
-    const T& operator()(usize x, usize y) const { return at(x, y); }
-
-    const T& operator()(Pos pos) const { return at(pos.real(), pos.imag()); }
-
-    bool operator==(const Grid<T> &rhs) const {
-        if (rhs.cols != cols || rhs.rows != rows)
-            return false;
-
-        for (usize y = 0; y < rows; y++) {
-            for (usize x = 0; x < cols; x++) {
-                if (at(x, y) != rhs(x, y))
-                    return false;
-            }
-        }
-        return true;
-    }
-
-    inline bool isOutOfBound(i32 x, i32 y) const {
-        return x < 0 || y < 0 || x >= (i32)cols || y >= (i32)rows;
-    }
-
-    bool isOutOfBound(const Pos &pos) const {
-        return isOutOfBound(pos.real(), pos.imag());
-    }
-
-    std::string toString() const {
-        std::stringstream ss;
-        for (size_t y = 0; y < rows; y++) {
-            for (size_t x = 0; x < cols; x++) {
-                ss << at(x, y);
-            }
-            ss << "\n";
-        }
-        return ss.str();
-    }
-
-    friend std::ostream& operator<<(std::ostream& os, const Grid<T>& grid) {
-        os << grid.toString();
-        return os;
-    }
-
-private:
-    std::vector<T> m_data;
-};
+// The BFS in `walkGridOpt` expands a diamond around the start, tiles keep its
+// frontier in cache.
+using TileGrid = Grid<Tile, Tiled<8>>;
 
 
-Grid<Tile> parseGrid(const input_t &in) {
-    Grid<> grid(in.size(), in[0].size(), Tile::Unreachable);
+TileGrid parseGrid(const input_t &in) {
+    TileGrid grid(in.size(), in[0].size(), Tile::Unreachable);
     for (usize y = 0; y < grid.rows; ++y) {
         for (usize x = 0; x < grid.cols; ++x) {
             grid(x, y) = tileFromChar(in[y][x]);
@@ -253,7 +122,7 @@ Grid<Tile> parseGrid(const input_t &in) {
 }
 
 
-i64 walkGrid(Grid<> &grid, const i32 max_steps, Pos pos) {
+i64 walkGrid(TileGrid &grid, const i32 max_steps, Pos pos) {
     if (max_steps % 2 == 0)
         grid(pos) = Tile::Reachable;
     std::deque<Pos> queue{pos};
@@ -278,7 +147,7 @@ i64 walkGrid(Grid<> &grid, const i32 max_steps, Pos pos) {
 }
 
 
-i64 walkGrid2(const Grid<> &grid, const i32 max_steps, Pos pos);
+i64 walkGrid2(const TileGrid &grid, const i32 max_steps, Pos pos);
 
 i64 part1(const input_t &in) {
     #ifdef _DEBUG
@@ -286,7 +155,7 @@ i64 part1(const input_t &in) {
     #else
     const i32 N = 64;
     #endif
-    Grid<> grid = parseGrid(in);
+    TileGrid grid = parseGrid(in);
     debug_println("Starting grid:\n{}", grid.toString());
     Pos start(0);
     for (usize y = 0, run = 1; run && y < grid.rows; ++y) {
@@ -319,7 +188,7 @@ struct State {
 
 
 
-i64 walkGridOpt(const Grid<> &grid, const i32 max_steps, Pos pos) {
+i64 walkGridOpt(const TileGrid &grid, const i32 max_steps, Pos pos) {
     i64 total = 0;
     std::deque<State> queue{State{pos, 0}};
     robin_hood::unordered_flat_set<Pos> seen{pos};
@@ -354,7 +223,7 @@ i64 part2(const input_t &in) {
     #else
     const i64 N = 26501365;
     #endif
-    Grid<> grid = parseGrid(in);
+    TileGrid grid = parseGrid(in);
     Pos start(0);
     for (usize y = 0, run = 1; run && y < grid.rows; ++y) {
         for (usize x = 0; x < grid.cols; ++x) {
@@ -371,7 +240,7 @@ i64 part2(const input_t &in) {
     const i64 nodd = (grid_half_width / 2 * 2 + 1) * (grid_half_width / 2 * 2 + 1);
     const i64 neven = ((grid_half_width + 1) / 2 * 2) * ((grid_half_width + 1) / 2 * 2);
     
-    Grid<> empty_grid = grid;
+    TileGrid empty_grid = grid;
     empty_grid(start) = Tile::Unreachable;
 
     const i64 odd_fill = walkGridOpt(empty_grid, size*2 + 1, start);
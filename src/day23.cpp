@@ -10,6 +10,8 @@
 #include <complex>
 #include <ranges>
 #include <queue>
+#include <deque>
+#include <cassert>
 
 #include "recycles.h"
 #include "robin_hood.h"
@@ -28,8 +30,8 @@ typedef std::vector<std::string> input_t;
 
 const std::array<Dir, 4> DIRS = {NORTH, SOUTH, EAST, WEST};
 
-using Graph = robin_hood::unordered_flat_map<Pos, std::vector<std::pair<Pos, i32>>>;
-using Set = robin_hood::unordered_flat_set<Pos>;
+// Junctions get dense ids, the start is 0 and the end is 1
+using Graph = CsrGraph<i32>;
 
 void usage(const std::string &program_name) {
     std::cout << "Usage: " << program_name << " <input_file>\n";
@@ -218,11 +220,13 @@ Graph createGraph(const Grid<Tile> &grid, const Pos &start, const Pos &end) {
         }
     }
 
-    Graph graph;
+    IdMap<Pos> ids;
+    for (const auto &node : nodes) {
+        ids(node);
+    }
+
+    std::vector<Graph::EdgeTriple> edges;
     for (const auto &node : nodes) {
-        if (!graph.contains(node))
-            graph[node] = {};
-        
         std::vector<Pos> neighs = findNeighbors(node, grid);
         for (const auto &n : neighs) {
             robin_hood::unordered_flat_set<Pos> seen{node};
@@ -232,9 +236,8 @@ Graph createGraph(const Grid<Tile> &grid, const Pos &start, const Pos &end) {
                 q.pop_front();
                 const Pos &p = pr.first;
                 const i32 d = pr.second;
-                auto it = std::find(nodes.begin(), nodes.end(), p);
-                if (it != nodes.end()) {
-                    graph[node].emplace_back(p, d);
+                if (auto id = ids.find(p)) {
+                    edges.push_back({ids(node), *id, d});
                     q.clear();
                     break;
                 }
@@ -250,24 +253,39 @@ Graph createGraph(const Grid<Tile> &grid, const Pos &start, const Pos &end) {
             }
         }
     }
-    return graph;
+    return Graph(ids.size(), edges);
 }
 
 
-i64 longestPath(Pos pos, Set &seen, Graph &graph, const Pos &end) {
-    if (pos == end)
-        return 0;
+// Exhaustive search over simple paths from node 0 to node 1 with an explicit
+// stack. Visited junctions are a bitmask, so the graph must have <= 64 nodes.
+i64 longestPath(const Graph &graph) {
+    assert(graph.size() <= 64 && "Too many junctions for a u64 mask.");
+    struct Frame {
+        u32 node;
+        u32 edge;   // next edge to try
+        i64 dist;
+    };
+
     i64 max = INT64_MIN;
-    seen.insert(pos);
-    std::vector<std::pair<Pos, i32>> ns = graph[pos];
-    for (const auto &n : ns) {
-        const Pos &np = n.first;
-        const i64 dist = n.second;
-        if (!seen.contains(np))
-            max = std::max(max,
-                longestPath(np, seen, graph, end) + dist);
+    u64 seen = 1;
+    std::vector<Frame> stack{{0, graph.edgeBegin(0), 0}};
+    while (!stack.empty()) {
+        Frame &f = stack.back();
+        if (f.node == 1 || f.edge == graph.edgeEnd(f.node)) {
+            if (f.node == 1)
+                max = std::max(max, f.dist);
+            seen &= ~(1ULL << f.node);
+            stack.pop_back();
+            continue;
+        }
+
+        const auto &e = graph.edge(f.edge++);
+        if (seen & (1ULL << e.to))
+            continue;
+        seen |= 1ULL << e.to;
+        stack.push_back({e.to, graph.edgeBegin(e.to), f.dist + e.weight});
     }
-    seen.erase(pos);
     return max;
 }
 
@@ -281,17 +299,16 @@ i64 part1(const input_t &in) {
     Graph graph = createGraph(grid, start, end);
 
     debug_println("{{");
-    for ([[maybe_unused]]const auto &[key, val] : graph) {
-        debug_print("  {}:[", key);
-        for ([[maybe_unused]]const auto &el : val)  {
-            debug_print("{{node:{}, dist:{}}},", el.first, el.second);
+    for (u32 u = 0; u < graph.size(); ++u) {
+        debug_print("  {}:[", u);
+        for ([[maybe_unused]]const auto &el : graph.neighbors(u))  {
+            debug_print("{{node:{}, dist:{}}},", el.to, el.weight);
         }
         debug_println("]");
     }
     debug_println("}}");
 
-    Set seen{};
-    return longestPath(start, seen, graph, end);
+    return longestPath(graph);
 }
 
 
@@ -310,17 +327,16 @@ i64 part2(const input_t &in) {
     Graph graph = createGraph(grid, start, end);
 
     debug_println("{{");
-    for ([[maybe_unused]]const auto &[key, val] : graph) {
-        debug_print("  {}:[", key);
-        for ([[maybe_unused]]const auto &el : val)  {
-            debug_print("{{node:{}, dist:{}}},", el.first, el.second);
+    for (u32 u = 0; u < graph.size(); ++u) {
+        debug_print("  {}:[", u);
+        for ([[maybe_unused]]const auto &el : graph.neighbors(u))  {
+            debug_print("{{node:{}, dist:{}}},", el.to, el.weight);
         }
         debug_println("]");
     }
     debug_println("}}");
 
-    Set seen{};
-    return longestPath(start, seen, graph, end);
+    return longestPath(graph);
 }
 
 
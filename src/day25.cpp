@@ -1,4 +1,15 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <format>
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+
+#include "recycles.h"
+
 
 #ifdef _DEBUG
     #define debug_println(fmt, ...) std::cout << std::format((fmt), ##__VA_ARGS__) << std::endl
@@ -9,12 +20,133 @@
 #endif
 
 
+typedef std::vector<std::string> input_t;
+
+using namespace utils;
+
+using Graph = CsrGraph<i32>;
+
+void usage(const std::string &program_name) {
+    std::cout << "Usage: " << program_name << " <input_file>\n";
+}
+
+
+input_t parseInputs(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Unable to open file \"" << filename << "\"!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    input_t lines;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        lines.emplace_back(std::move(line));
+    }
+
+    file.close();
+    return lines;
+}
+
+
+// Every wire is stored as two directed edges
+Graph createGraph(const input_t &in) {
+    IdMap<std::string> ids;
+    std::vector<Graph::EdgeTriple> edges;
+    for (const auto &line : in) {
+        std::istringstream iss(line);
+        std::string name;
+        std::string other;
+        iss >> name;
+        name.pop_back();    // ':'
+        const u32 node = ids(name);
+        while (iss >> other) {
+            const u32 o = ids(other);
+            edges.push_back({node, o, 1});
+            edges.push_back({o, node, 1});
+        }
+    }
+    return Graph(ids.size(), edges);
+}
+
+
+// Id of the edge going the opposite way of each edge
+std::vector<u32> reverseEdges(const Graph &graph) {
+    std::vector<u32> rev(graph.edgeCount());
+    for (u32 u = 0; u < graph.size(); ++u) {
+        for (u32 e = graph.edgeBegin(u); e < graph.edgeEnd(u); ++e) {
+            const u32 v = graph.edge(e).to;
+            for (u32 r = graph.edgeBegin(v); r < graph.edgeEnd(v); ++r) {
+                if (graph.edge(r).to == u) {
+                    rev[e] = r;
+                    break;
+                }
+            }
+        }
+    }
+    return rev;
+}
+
+
+// Size of the side of `source` if the minimum cut between `source` and `sink`
+// is exactly `cut` wires, 0 otherwise. Unit capacity max-flow with BFS
+// augmenting paths (Edmonds-Karp).
+usize cutSide(const Graph &graph, const std::vector<u32> &rev, u32 source, u32 sink, i32 cut) {
+    std::vector<i32> flow(graph.edgeCount(), 0);
+    auto residual = [&](u32 e) { return flow[e] < 1; };
+
+    for (i32 i = 0; i < cut; ++i) {
+        const auto tree = graph.bfs(source, residual);
+        if (!tree.reached(sink))
+            return 0;
+        for (u32 v = sink; v != source;) {
+            const u32 e = tree.parent[v];
+            flow[e]++;
+            flow[rev[e]]--;
+            v = graph.edge(rev[e]).to;
+        }
+    }
+
+    const auto tree = graph.bfs(source, residual);
+    if (tree.reached(sink))
+        return 0;
+    usize side = 0;
+    for (u32 v = 0; v < graph.size(); ++v) {
+        side += tree.reached(v);
+    }
+    return side;
+}
+
+
+i64 part1(const input_t &in) {
+    const Graph graph = createGraph(in);
+    const std::vector<u32> rev = reverseEdges(graph);
+    debug_println("{} components, {} wires", graph.size(), graph.edgeCount() / 2);
+
+    // Any node on the other side of the 3-wire cut has a max-flow of exactly
+    // 3 from node 0.
+    for (u32 sink = 1; sink < graph.size(); ++sink) {
+        const usize side = cutSide(graph, rev, 0, sink, 3);
+        if (side) {
+            debug_println("Cut between 0 and {}, groups of {} and {}", sink, side, graph.size() - side);
+            return side * (graph.size() - side);
+        }
+    }
+    return -1;
+}
+
+
 int main(int argc, char *argv[]) {
-    std::cout << "Run the python file `day25.py` because I had no luck with boost! Command to run : `python3 src/day25.py";
-    #ifdef _DEBUG
-    std::cout << " DEBUG";
-    #endif
-    std::cout << "`" << std::endl;
+    if (argc < 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    input_t lines = parseInputs(argv[1]);
+
+    auto res1 = part1(lines);
+    std::cout << "-----PART 1-----\n";
+    std::cout << "Result = " << res1 << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}